@@ -0,0 +1,96 @@
+#include <capo/capo.hpp>
+#include <ktl/kformat.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using Nanos = std::chrono::duration<float, std::nano>;
+
+static constexpr int fail_code = 2;
+static constexpr std::size_t sounds_v = 10000;
+static constexpr std::size_t sources_v = 1000;
+
+// average cost of one of count operations
+template <typename F>
+Nanos measure(F run, std::size_t const count) {
+	auto const start = Clock::now();
+	run();
+	return Nanos(Clock::now() - start) / static_cast<float>(count);
+}
+
+void print(std::string_view name, Nanos const time) { std::cout << ktl::kformat("  {}\t: {:.0f}ns\n", name, time.count()); }
+} // namespace
+
+int main(int argc, char** argv) {
+	int const rounds = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 100;
+	auto instance = capo::Instance::make();
+	if (!instance || !instance->valid()) {
+		std::cerr << "Failed to create Instance" << std::endl;
+		return fail_code;
+	}
+	// tiny clips: measures bookkeeping, not uploads
+	auto pcm = capo::PCM{};
+	pcm.meta = {.rate = 48000, .format = capo::SampleFormat::eMono16, .total_frame_count = 64};
+	pcm.samples.resize(pcm.meta.total_frame_count);
+	std::fill(pcm.samples.begin(), pcm.samples.end(), capo::PCM::Sample{});
+	pcm.bytes = pcm.samples.size() * sizeof(capo::PCM::Sample);
+
+	auto sounds = std::vector<capo::Sound>();
+	auto sources = std::vector<capo::Source>();
+	sounds.reserve(sounds_v);
+	sources.reserve(sources_v);
+	auto const make_sound = measure([&] {
+		for (std::size_t i = 0; i < sounds_v; ++i) { sounds.push_back(instance->make_sound(pcm)); }
+	}, sounds_v);
+	auto const make_source = measure([&] {
+		for (std::size_t i = 0; i < sources_v; ++i) { sources.push_back(instance->make_source()); }
+	}, sources_v);
+	if (std::any_of(sounds.begin(), sounds.end(), [](capo::Sound const& s) { return !s.valid(); })) {
+		std::cerr << "Failed to make Sounds" << std::endl;
+		return fail_code;
+	}
+
+	std::size_t found{};
+	auto const find_sound = measure([&] {
+		for (int round{}; round < rounds; ++round) {
+			for (auto const& sound : sounds) { found += instance->find_sound(sound.id()).valid() ? 1 : 0; }
+		}
+	}, sounds_v * static_cast<std::size_t>(rounds));
+	auto const find_source = measure([&] {
+		for (int round{}; round < rounds; ++round) {
+			for (auto const& source : sources) { found += instance->find_source(source.id()).valid() ? 1 : 0; }
+		}
+	}, sources_v * static_cast<std::size_t>(rounds));
+	auto const bind = measure([&] {
+		for (std::size_t i = 0; i < sources_v; ++i) { sources[i].bind(sounds[(i * 7) % sounds_v]); }
+	}, sources_v);
+	auto const bound = measure([&] {
+		for (auto const& source : sources) { found += source.bound().valid() ? 1 : 0; }
+	}, sources_v);
+	auto const destroy_source = measure([&] {
+		for (auto const& source : sources) { instance->destroy(source); }
+	}, sources_v);
+	auto const destroy_sound = measure([&] {
+		for (auto const& sound : sounds) { instance->destroy(sound); }
+	}, sounds_v);
+	// stale handles must be rejected
+	if (instance->find_sound(sounds.front().id()).valid() || instance->find_source(sources.front().id()).valid()) {
+		std::cerr << "Stale handle resolved" << std::endl;
+		return fail_code;
+	}
+
+	std::cout << ktl::kformat("{} sounds, {} sources, {} lookup round(s), {} found\n", sounds_v, sources_v, rounds, found);
+	print("make_sound", make_sound);
+	print("make_source", make_source);
+	print("find_sound", find_sound);
+	print("find_source", find_source);
+	print("bind", bind);
+	print("bound", bound);
+	print("destroy (source)", destroy_source);
+	print("destroy (sound)", destroy_sound);
+}
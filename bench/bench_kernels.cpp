@@ -0,0 +1,75 @@
+#include <impl_simd.hpp>
+#include <ktl/kformat.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using Micros = std::chrono::duration<float, std::micro>;
+using capo::detail::Kernels;
+using capo::detail::SimdLevel;
+
+// 1s of 48kHz stereo
+static constexpr std::size_t frames_v = 48000;
+static constexpr std::size_t samples_v = frames_v * 2;
+
+struct Buffers {
+	std::vector<float> f32_in = std::vector<float>(samples_v);
+	std::vector<float> f32_out = std::vector<float>(samples_v);
+	std::vector<std::int16_t> s16 = std::vector<std::int16_t>(samples_v);
+	float sink{};
+};
+
+template <typename F>
+Micros measure(F run, int const rounds) {
+	auto const start = Clock::now();
+	for (int round{}; round < rounds; ++round) { run(); }
+	return Micros(Clock::now() - start) / static_cast<float>(rounds);
+}
+
+void bench(std::string_view name, Kernels const& k, Buffers& b, int const rounds) {
+	float* in = b.f32_in.data();
+	float* out = b.f32_out.data();
+	std::int16_t* s16 = b.s16.data();
+	// one resampler output frame (per channel) per input frame
+	auto const dot = [&] {
+		for (std::size_t i = 0; i + 32 <= frames_v; ++i) { b.sink += k.dot(in + i, in + frames_v, 32); }
+	};
+	auto const results = {
+		std::pair{"s16_to_f32", measure([&] { k.s16_to_f32(s16, out, samples_v); }, rounds)},
+		std::pair{"f32_to_s16", measure([&] { k.f32_to_s16(in, s16, samples_v); }, rounds)},
+		std::pair{"mono_to_stereo", measure([&] { k.mono_to_stereo(in, out, frames_v); }, rounds)},
+		std::pair{"stereo_to_mono", measure([&] { k.stereo_to_mono(in, out, frames_v); }, rounds)},
+		std::pair{"gain", measure([&] { k.gain(out, samples_v, 0.999f); }, rounds)},
+		std::pair{"interleave", measure([&] { k.interleave(in, in + frames_v, out, frames_v); }, rounds)},
+		std::pair{"deinterleave", measure([&] { k.deinterleave(in, out, out + frames_v, frames_v); }, rounds)},
+		std::pair{"dot (32 taps)", measure(dot, rounds)},
+	};
+	std::cout << ktl::kformat("{}\n", name);
+	for (auto const& [kernel, time] : results) { std::cout << ktl::kformat("  {}\t: {:.1f}us\n", kernel, time.count()); }
+}
+} // namespace
+
+int main(int argc, char** argv) {
+	int const rounds = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 100;
+	auto buffers = Buffers{};
+	auto rng = std::mt19937{};
+	auto dist = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+	std::generate(buffers.f32_in.begin(), buffers.f32_in.end(), [&] { return dist(rng); });
+	std::cout << ktl::kformat("{} frames (stereo), {} round(s), detected: {}\n", frames_v, rounds, capo::detail::simd_name(capo::detail::simd_level()));
+	auto levels = std::vector<SimdLevel>{SimdLevel::eScalar};
+	switch (capo::detail::simd_level()) {
+	case SimdLevel::eAvx2: levels.insert(levels.end(), {SimdLevel::eSse2, SimdLevel::eAvx2}); break;
+	case SimdLevel::eSse2: levels.push_back(SimdLevel::eSse2); break;
+	case SimdLevel::eNeon: levels.push_back(SimdLevel::eNeon); break;
+	default: break;
+	}
+	for (auto const level : levels) { bench(capo::detail::simd_name(level), capo::detail::kernels(level), buffers, rounds); }
+	if (buffers.sink == 0.0f) { std::cout << "\n"; } // keep dot results alive
+}
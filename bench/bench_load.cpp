@@ -0,0 +1,72 @@
+#include <capo/capo.hpp>
+#include <ktl/kformat.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<float, std::milli>;
+
+static constexpr int fail_code = 2;
+
+capo::FileFormat format_from_path(std::string_view path) {
+	if (path.ends_with(".wav")) { return capo::FileFormat::eWav; }
+	if (path.ends_with(".flac")) { return capo::FileFormat::eFlac; }
+	if (path.ends_with(".mp3")) { return capo::FileFormat::eMp3; }
+	if (path.ends_with(".capo")) { return capo::FileFormat::eCapo; }
+	return capo::FileFormat::eUnknown;
+}
+
+// reference path: read entire compressed file into a heap buffer, then decode
+capo::Result<capo::PCM> load_ifstream(char const* path) {
+	auto file = std::ifstream(path, std::ios::binary | std::ios::ate);
+	if (!file) { return capo::Error::eIOError; }
+	auto const size = file.tellg();
+	auto buf = std::vector<std::byte>(static_cast<std::size_t>(size));
+	file.seekg(0, std::ios::beg);
+	file.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(size));
+	return capo::PCM::from_memory(buf, format_from_path(path));
+}
+
+capo::Result<capo::PCM> load_mapped(char const* path) { return capo::PCM::from_file(path); }
+
+template <typename F>
+Millis measure(F load, char const* path, int const rounds) {
+	auto total = Millis();
+	for (int round{}; round < rounds; ++round) {
+		auto const start = Clock::now();
+		auto pcm = load(path);
+		total += Clock::now() - start;
+		if (!pcm) {
+			std::cerr << "Failed to load " << path << std::endl;
+			return Millis(-1.0f);
+		}
+	}
+	return total / static_cast<float>(rounds);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Syntax: " << argv[0] << " <audio file path> [rounds]" << std::endl;
+		return fail_code;
+	}
+	char const* path = argv[1];
+	int const rounds = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 5;
+	auto const pcm = capo::PCM::from_file(path);
+	if (!pcm) {
+		std::cerr << "Failed to load " << path << std::endl;
+		return fail_code;
+	}
+	std::cout << ktl::kformat("{}: {:.1f}s, {} decoded, {} round(s)\n", path, pcm->meta.length().count(), pcm->size(), rounds);
+	auto const ifstream = measure(&load_ifstream, path, rounds);
+	auto const mapped = measure(&load_mapped, path, rounds);
+	if (ifstream.count() < 0.0f || mapped.count() < 0.0f) { return fail_code; }
+	std::cout << ktl::kformat("  ifstream + from_memory\t: {:.2f}ms\n", ifstream.count());
+	std::cout << ktl::kformat("  from_file (mapped)\t: {:.2f}ms\n", mapped.count());
+}
@@ -0,0 +1,60 @@
+#include <capo/capo.hpp>
+#include <ktl/kformat.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+namespace {
+static constexpr int fail_code = 2;
+
+// crossfade just before a gapless boundary: the decoder has already moved on to the queued track, the listener has not
+int playlist_test(char const* first, char const* second, char const* third, capo::Time const fade) {
+	auto instance = capo::Instance::make();
+	if (!instance->valid()) {
+		std::cerr << "Couldn't create valid instance." << std::endl;
+		return fail_code;
+	}
+
+	capo::Music music(instance.get());
+	if (!music.open(first) || !music.enqueue(second)) {
+		std::cerr << "Failed to open " << first << " / " << second << std::endl;
+		return fail_code;
+	}
+	auto const first_meta = music.meta();
+	if (!music.play()) {
+		std::cerr << "Failed to play " << first << std::endl;
+		return fail_code;
+	}
+	std::cout << ktl::kformat("Playing {} ({:.1f}s), {} queued\n", first, first_meta.length().count(), music.queued());
+
+	// wait until the end of the first track is buffered (but not yet heard)
+	auto const boundary = first_meta.length() - capo::Time(0.1f);
+	while (music.state() == capo::State::ePlaying && music.position() < boundary) { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }
+	assert(music.queued() == 1);
+	if (!music.crossfade(fade, third)) {
+		std::cerr << "Failed to crossfade to " << third << std::endl;
+		return fail_code;
+	}
+	// second track was dropped: first is still audible (fading out), third is pending
+	assert(music.queued() == 1);
+	assert(music.meta().total_frame_count == first_meta.total_frame_count);
+	std::cout << ktl::kformat("Crossfading to {} over {:.1f}s at {:.2f}s\n", third, fade.count(), music.position().count());
+
+	while (music.state() == capo::State::ePlaying && music.queued() > 0) { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }
+	std::cout << ktl::kformat("Now playing {} ({:.1f}s) from {:.2f}s\n", third, music.meta().length().count(), music.position().count());
+	std::this_thread::sleep_for(std::chrono::duration_cast<std::chrono::milliseconds>(fade) + std::chrono::seconds(1));
+	music.stop();
+	return 0;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+	if (argc < 4) {
+		std::cerr << "Syntax: " << argv[0] << " <first> <second (queued)> <third (crossfaded to)> [fade seconds]" << std::endl;
+		return fail_code;
+	}
+	float const fade = argc > 4 ? static_cast<float>(std::atof(argv[4])) : 2.0f;
+	return playlist_test(argv[1], argv[2], argv[3], capo::Time(fade > 0.0f ? fade : 2.0f));
+}
@@ -34,8 +34,8 @@ bool sound_test(char const* wav_path, float gain, bool loop) {
 	if (!pcm) {
 		switch (pcm.error()) {
 		case capo::Error::eUnknownFormat:
-			static_assert(static_cast<std::size_t>(capo::FileFormat::eCOUNT_) == 4, "Unhandled file format");
-			std::cerr << "File format not supported. Currently supported formats: MP3, WAV and FLAC" << std::endl;
+			static_assert(static_cast<std::size_t>(capo::FileFormat::eCOUNT_) == 5, "Unhandled file format");
+			std::cerr << "File format not supported. Currently supported formats: MP3, WAV, FLAC and capo" << std::endl;
 			break;
 
 		case capo::Error::eIOError: std::cerr << "Couldn't open audio file. Check if the file exists and if it is readable." << std::endl; break;
@@ -60,7 +60,7 @@ bool sound_test(char const* wav_path, float gain, bool loop) {
 	std::cout << ktl::kformat("{} info:\n\t{:.1f}s Length\n\t{} Channel(s)\n\t{} Sample Rate\n\t{} Size\n", wav_path, meta.length().count(),
 							  pcm->meta.channel_count(meta.format), sound.sample_rate(), sound.size());
 	std::cout << ktl::kformat("Playing {} once at {:.2f} gain\n", wav_path, gain);
-	if (pcm->meta.format == capo::SampleFormat::eMono16) {
+	if (capo::Metadata::channel_count(pcm->meta.format) == 1) {
 		std::cout << ktl::kformat("Travelling on a circurference around the listener; r={:.1f}, angular speed={:.1f}\n", travel_circurference_radius,
 								  travel_angular_speed);
 	} else {
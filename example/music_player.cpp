@@ -12,8 +12,6 @@
 #include <future>
 
 namespace {
-using namespace std::chrono_literals;
-
 static constexpr int fail_code = 2;
 
 constexpr capo::utils::EnumArray<capo::State, std::string_view> g_stateNames = {
@@ -78,7 +76,7 @@ class Playlist {
 		if (multi_track()) {
 			m_idx = prev_idx();
 			if (m_mode == Mode::ePreload) {
-				auto& cache = m_cache.prev.fence.valid() ? m_cache.prev : m_cache.next;
+				auto& cache = m_cache.prev.pcm.valid() ? m_cache.prev : m_cache.next;
 				m_current = std::move(cache)();
 				load_cache();
 			}
@@ -87,13 +85,9 @@ class Playlist {
 
   private:
 	struct Cache {
-		std::future<void> fence;
-		capo::PCM pcm;
+		std::future<capo::Result<capo::PCM>> pcm;
 
-		capo::PCM operator()() && {
-			fence.wait();
-			return std::move(pcm);
-		}
+		capo::PCM operator()() && { return *pcm.get(); }
 	};
 
 	static capo::PCM load(char const* path) { return *capo::PCM::from_file(path); }
@@ -102,20 +96,23 @@ class Playlist {
 	std::size_t prev_idx() const noexcept { return (m_idx + m_tracklist.size() - 1) % m_tracklist.size(); }
 
 	void load_cache() {
-		if (multi_track()) {
-			if (m_cache.next.fence.wait_for(0s) == std::future_status::deferred) { m_cache.next.fence.wait(); }
-			m_cache.next.fence = std::async([this]() { m_cache.next.pcm = load(m_tracklist[next_idx()].c_str()); });
-		}
-		if (m_tracklist.size() > 2) {
-			if (m_cache.prev.fence.wait_for(0s) == std::future_status::deferred) { m_cache.prev.fence.wait(); }
-			m_cache.prev.fence = std::async([this]() { m_cache.prev.pcm = load(m_tracklist[prev_idx()].c_str()); });
-		}
+		// drop any stale requests (eg skipping through several tracks quickly)
+		m_batch.cancel();
+		std::vector<capo::Loader::Request> requests;
+		if (multi_track()) { requests.push_back({.source = m_tracklist[next_idx()], .priority = 1}); }
+		if (m_tracklist.size() > 2) { requests.push_back({.source = m_tracklist[prev_idx()]}); }
+		m_batch = m_loader.load(requests);
+		m_cache = {};
+		if (!m_batch.futures.empty()) { m_cache.next.pcm = std::move(m_batch.futures[0]); }
+		if (m_batch.futures.size() > 1) { m_cache.prev.pcm = std::move(m_batch.futures[1]); }
 	}
 
 	struct {
 		Cache next;
 		Cache prev;
 	} m_cache;
+	capo::Loader m_loader{2};
+	capo::Loader::Batch m_batch;
 	Tracklist m_tracklist;
 	capo::PCM m_current;
 	std::size_t m_idx{};
@@ -1,7 +1,10 @@
 #pragma once
 #include <capo/instance.hpp>
+#include <capo/loader.hpp>
 #include <capo/music.hpp>
 #include <capo/pcm.hpp>
+#include <capo/pcm_cache.hpp>
+#include <capo/reader.hpp>
 #include <string_view>
 
 namespace capo {
@@ -1,8 +1,10 @@
 #pragma once
+#include <capo/metadata.hpp>
 #include <capo/sound.hpp>
 #include <capo/source.hpp>
 #include <capo/types.hpp>
 #include <ktl/kunique_ptr.hpp>
+#include <span>
 #include <vector>
 
 namespace capo {
@@ -35,9 +37,20 @@ class Instance {
 	explicit operator bool() const noexcept { return valid(); }
 
 	Sound const& make_sound(PCM const& pcm);
+	///
+	/// \brief Make a Sound from compressed bytes: 16-bit PCM WAV data is uploaded as-is, other formats are decoded first
+	///
+	Sound const& make_sound(std::span<std::byte const> bytes);
+	///
+	/// \brief Make a Sound from a file (mapped into memory, see above)
+	///
+	Sound const& make_sound(char const* path);
 	Source const& make_source();
 	bool destroy(Sound const& sound);
 	bool destroy(Source const& source);
+	///
+	/// \brief Find a Sound / Source by id(): O(1), blank if destroyed (stale ids never alias newer instances)
+	///
 	Sound const& find_sound(UID id) const noexcept;
 	Source const& find_source(UID id) const noexcept;
 
@@ -47,6 +60,14 @@ class Instance {
 
 	static std::vector<Device> devices();
 	Result<Device> device() const;
+	///
+	/// \brief Output sample rate of the device (mixing rate); 0 if unknown
+	///
+	SampleRate sample_rate() const;
+	///
+	/// \brief Number of Music streams driven by the streaming scheduler (shared by all instances)
+	///
+	std::size_t stream_count() const;
 
   private:
 	struct Impl;
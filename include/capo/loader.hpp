@@ -0,0 +1,78 @@
+#pragma once
+#include <capo/pcm.hpp>
+#include <ktl/kunique_ptr.hpp>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <variant>
+
+namespace capo {
+///
+/// \brief Decodes batches of audio assets on a bounded pool of worker threads
+///
+/// Pending requests are decoded in order of priority (highest first), then submission
+/// Requests cancelled before a worker picks them up resolve to Error::eCancelled
+///
+class Loader {
+  public:
+	using Priority = int;
+	///
+	/// \brief Callback invoked on a worker thread as each request completes (before its future is ready)
+	///
+	using OnLoaded = std::function<void(std::size_t index, Result<PCM> const& pcm)>;
+
+	///
+	/// \brief Single asset to decode: a file path or compressed bytes (owned by the caller until loaded)
+	///
+	struct Request {
+		std::variant<std::string, std::span<std::byte const>> source{};
+		FileFormat format{};
+		Priority priority{};
+		DecodeInfo decode{};
+	};
+
+	///
+	/// \brief Handle to a submitted batch: one future per request, in submission order
+	///
+	class Batch {
+	  public:
+		std::vector<std::future<Result<PCM>>> futures{};
+
+		///
+		/// \brief Cancel all requests in this batch which have not started decoding yet
+		///
+		void cancel() noexcept {
+			if (m_cancel) { m_cancel->store(true); }
+		}
+		bool cancelled() const noexcept { return m_cancel && m_cancel->load(); }
+
+	  private:
+		std::shared_ptr<std::atomic_bool> m_cancel{};
+
+		friend class Loader;
+	};
+
+	///
+	/// \brief Construct a loader with a fixed number of worker threads (0 => hardware concurrency)
+	///
+	explicit Loader(std::size_t threads = 0);
+	Loader(Loader&&) noexcept;
+	Loader& operator=(Loader&&) noexcept;
+	///
+	/// \brief Cancels all pending requests and joins workers
+	///
+	~Loader();
+
+	Batch load(std::span<Request const> requests, OnLoaded on_loaded = {});
+	std::future<Result<PCM>> load(Request request);
+
+	std::size_t threads() const noexcept;
+	std::size_t pending() const;
+
+  private:
+	struct Impl;
+	ktl::kunique_ptr<Impl> m_impl{};
+};
+} // namespace capo
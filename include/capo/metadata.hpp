@@ -3,7 +3,8 @@
 #include <capo/utils/format_unit.hpp>
 
 namespace capo {
-enum class SampleFormat { eMono16, eStereo16 };
+enum class SampleFormat { eMono16, eStereo16, eMonoF32, eStereoF32 };
+enum class SampleType { eS16, eF32 };
 using SampleRate = std::size_t;
 
 ///
@@ -22,6 +23,16 @@ struct Metadata {
 	static constexpr bool supported(std::size_t channels) noexcept { return channels > 0 && channels <= max_channels_v; }
 
 	static constexpr std::size_t sample_count(std::size_t pcm_frame_count, std::size_t channels) noexcept { return pcm_frame_count * channels; }
-	static constexpr std::size_t channel_count(SampleFormat format) noexcept { return format == SampleFormat::eStereo16 ? 2 : 1; }
+	static constexpr std::size_t channel_count(SampleFormat format) noexcept {
+		return format == SampleFormat::eStereo16 || format == SampleFormat::eStereoF32 ? 2 : 1;
+	}
+	static constexpr SampleType sample_type(SampleFormat format) noexcept {
+		return format == SampleFormat::eMonoF32 || format == SampleFormat::eStereoF32 ? SampleType::eF32 : SampleType::eS16;
+	}
+	static constexpr std::size_t sample_size(SampleFormat format) noexcept { return sample_type(format) == SampleType::eF32 ? 4 : 2; }
+	static constexpr SampleFormat make_format(std::size_t channels, SampleType type) noexcept {
+		if (type == SampleType::eF32) { return channels == 2 ? SampleFormat::eStereoF32 : SampleFormat::eMonoF32; }
+		return channels == 2 ? SampleFormat::eStereo16 : SampleFormat::eMono16;
+	}
 };
 } // namespace capo
@@ -1,6 +1,8 @@
 #pragma once
 #include <capo/pcm.hpp>
 #include <capo/source.hpp>
+#include <array>
+#include <cstdint>
 #include <ktl/kunique_ptr.hpp>
 #include <ktl/not_null.hpp>
 
@@ -11,10 +13,83 @@ class Instance;
 /// \brief Streams music from filesystem / memory
 ///
 /// Requires a pointer to an existing instance to activate
-/// Uses a polling thread to swap buffers
+/// Buffers are refilled by a thread pool shared by all instances (see Instance::stream_count())
 ///
 class Music {
   public:
+	///
+	/// \brief Streaming buffer configuration
+	///
+	/// About buffer_count * frame_size samples are queued for playback (eg 3 * 4096 => ~140ms at 44.1kHz stereo)
+	///
+	struct Buffering {
+		static constexpr std::size_t min_buffers_v = 2;
+		static constexpr std::size_t max_buffers_v = 8;
+		static constexpr std::size_t min_frame_size_v = 512;
+		static constexpr std::size_t max_frame_size_v = 32768;
+
+		///
+		/// \brief Number of buffers queued [min_buffers_v, max_buffers_v]
+		///
+		std::size_t buffer_count{3};
+		///
+		/// \brief Samples per buffer (all channels) [min_frame_size_v, max_frame_size_v]
+		///
+		std::size_t frame_size{4096};
+		///
+		/// \brief Target latency (duration of all queued buffers): if non-zero, frame_size is derived from it (per stream)
+		///
+		Time latency{};
+		///
+		/// \brief Grow the queue after underruns / at high pitch, shrink it back once playback has been stable for a while
+		///
+		bool adaptive{};
+	};
+
+	///
+	/// \brief Streaming health telemetry (since the stream was opened)
+	///
+	struct Stats {
+		///
+		/// \brief Log2 histogram of durations: bucket i counts durations in [2^(i-1), 2^i) microseconds
+		///
+		/// Bucket 0 counts durations under 1us, the last bucket all durations beyond its lower bound
+		///
+		struct Histogram {
+			static constexpr std::size_t buckets_v = 24;
+
+			std::array<std::uint64_t, buckets_v> buckets{};
+			std::uint64_t count{};
+			Time max{};
+		};
+
+		///
+		/// \brief Number of times the source ran dry while more audio was (or would soon be) available
+		///
+		std::uint64_t underruns{};
+		///
+		/// \brief Fewest buffers observed queued (not yet played) during playback
+		///
+		std::size_t min_queued{};
+		///
+		/// \brief Frames (buffers' worth of samples) decoded
+		///
+		std::uint64_t frames_decoded{};
+		///
+		/// \brief Bytes of samples read from the decoder
+		///
+		std::uint64_t bytes_read{};
+		///
+		/// \brief Time taken to decode each frame
+		///
+		Histogram decode_time{};
+		///
+		/// \brief Delay between a refill's deadline and when it was actually serviced
+		///
+		Histogram tick_latency{};
+	};
+
+
 	Music();
 	Music(ktl::not_null<Instance*> instance);
 	Music(Music&&) noexcept;
@@ -35,9 +110,70 @@ class Music {
 	///
 	Result<void> open(char const* path);
 	///
+	/// \brief Open compressed bytes (eg from a pak file / download) for streaming, decoding incrementally
+	///
+	/// bytes must outlive this instance (or the next call to open / preload); they are not copied
+	///
+	Result<void> open(std::span<std::byte const> bytes, FileFormat format = FileFormat::eUnknown);
+	///
+	/// \brief Open reader (eg an entry in a packed archive) for streaming, pulling bytes as required
+	///
+	/// reader must outlive this instance (or the next call to open / preload)
+	///
+	Result<void> open(Reader& reader, FileFormat format = FileFormat::eUnknown);
+	///
 	/// \brief Preload pcm for streaming
 	///
 	Result<void> preload(PCM pcm);
+	///
+	/// \brief Preload shared pcm for streaming (eg obtained from a PCMCache)
+	///
+	Result<void> preload(std::shared_ptr<PCM const> pcm);
+
+	///
+	/// \brief Queue a file at path to play after the current stream (and any queued before it), without a gap
+	///
+	/// Opens the current stream instead if none is open; the queued stream is converted to the current one's channel layout / sample rate.
+	/// Queued streams are discarded by open / preload, and not reached while looping (which repeats the current stream).
+	///
+	Result<void> enqueue(char const* path);
+	///
+	/// \brief Queue compressed bytes to play after the current stream (bytes must outlive playback)
+	///
+	Result<void> enqueue(std::span<std::byte const> bytes, FileFormat format = FileFormat::eUnknown);
+	///
+	/// \brief Queue reader to play after the current stream (reader must outlive playback)
+	///
+	Result<void> enqueue(Reader& reader, FileFormat format = FileFormat::eUnknown);
+	///
+	/// \brief Queue shared pcm to play after the current stream
+	///
+	Result<void> enqueue(std::shared_ptr<PCM const> pcm);
+	///
+	/// \brief Number of queued streams yet to start playing
+	///
+	std::size_t queued() const;
+
+	///
+	/// \brief Crossfade from the current stream to a file at path over duration
+	///
+	/// Both streams are decoded and mixed (with a per-sample gain ramp) into the same source, starting with the next buffer to be queued.
+	/// Discards queued streams; opens the stream instead if nothing is playing. The incoming stream is converted to the current one's
+	/// channel layout / sample rate.
+	///
+	Result<void> crossfade(Time duration, char const* path);
+	///
+	/// \brief Crossfade from the current stream to compressed bytes over duration (bytes must outlive playback)
+	///
+	Result<void> crossfade(Time duration, std::span<std::byte const> bytes, FileFormat format = FileFormat::eUnknown);
+	///
+	/// \brief Crossfade from the current stream to reader over duration (reader must outlive playback)
+	///
+	Result<void> crossfade(Time duration, Reader& reader, FileFormat format = FileFormat::eUnknown);
+	///
+	/// \brief Crossfade from the current stream to shared pcm over duration
+	///
+	Result<void> crossfade(Time duration, std::shared_ptr<PCM const> pcm);
 
 	bool play();
 	bool pause();
@@ -49,14 +185,29 @@ class Music {
 	float pitch() const;
 	bool loop(bool value);
 	bool looping() const;
+	///
+	/// \brief Configure buffering (takes effect with the next buffer queued; also applies to subsequently opened streams)
+	///
+	bool buffering(Buffering const& value);
+	Buffering buffering() const;
 	Result<void> seek(Time stamp);
+	///
+	/// \brief Playback position
+	///
+	/// position, meta, size, sample_rate and state read a snapshot published by the streaming thread:
+	/// they never lock or query OpenAL (position is extrapolated from the latest snapshot while playing)
+	///
 	Time position() const;
 
-	Metadata const& meta() const;
+	Metadata meta() const;
 	utils::Size size() const;
 	utils::Rate sample_rate() const;
 
 	State state() const;
+	///
+	/// \brief Obtain streaming telemetry (lock-free)
+	///
+	Stats stats() const;
 
   private:
 	struct Impl;
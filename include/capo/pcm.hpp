@@ -1,46 +1,140 @@
 #pragma once
 #include <capo/metadata.hpp>
+#include <capo/reader.hpp>
 #include <capo/types.hpp>
+#include <capo/utils/default_init_allocator.hpp>
 #include <capo/utils/format_unit.hpp>
 #include <ktl/kunique_ptr.hpp>
+#include <memory>
 #include <span>
 #include <vector>
 
 namespace capo {
-enum class FileFormat { eUnknown, eWav, eMp3, eFlac, eCOUNT_ };
+///
+/// \brief Audio file format
+///
+/// eCapo: pre-decoded samples (see PCM::bake()), loaded / streamed without decoding
+///
+enum class FileFormat { eUnknown, eWav, eMp3, eFlac, eCapo, eCOUNT_ };
+
+///
+/// \brief Options for decoding compressed audio into PCM
+///
+struct DecodeInfo {
+	///
+	/// \brief Max threads to decode a single clip on (0 => hardware concurrency)
+	///
+	/// Long seekable clips (WAV / FLAC) are split into frame ranges decoded concurrently; MP3 is always decoded serially
+	///
+	std::size_t threads{1};
+	///
+	/// \brief Sample type to decode into
+	///
+	SampleType type{SampleType::eS16};
+	///
+	/// \brief Sample rate to resample to after decoding (0 => native rate), eg Instance::sample_rate()
+	///
+	/// Normalizing clips to the device rate once at load spares the mixer resampling them per voice
+	///
+	SampleRate rate{};
+	///
+	/// \brief Memory resource to allocate samples from (eg a per-level arena; nullptr => std::pmr::get_default_resource())
+	///
+	/// Must outlive decoded PCM; must be synchronized (eg std::pmr::synchronized_pool_resource) if shared across threads / Loader workers
+	///
+	std::pmr::memory_resource* resource{};
+};
 
 ///
 /// \brief Uncompressed PCM data
 ///
-/// Only 16-bit Mono/Stereo is supported
+/// Supports 16-bit integer and 32-bit float Mono/Stereo; meta.format determines which storage holds the samples
+/// Storage allocates from a std::pmr::memory_resource, and does not zero-fill on resize()
+/// Note: move-assigning storage across different memory resources copies elements (pmr semantics); prefer move-construction
 ///
 struct PCM {
 	using Sample = std::int16_t;
+	using SampleF32 = float;
+	template <typename T>
+	using Storage = std::vector<T, utils::DefaultInitAllocator<T>>;
 	class Streamer;
 
 	static constexpr std::size_t max_channels_v = 2;
 
 	Metadata meta{};
-	std::vector<Sample> samples{};
+	Storage<Sample> samples{};
+	Storage<SampleF32> samples_f32{};
 	std::size_t bytes{};
 
 	utils::Size size() const noexcept { return utils::Size::make(bytes); }
+	///
+	/// \brief Raw bytes of the interleaved samples (of either type)
+	///
+	std::span<std::byte const> data() const noexcept {
+		if (Metadata::sample_type(meta.format) == SampleType::eF32) { return std::as_bytes(std::span(samples_f32)); }
+		return std::as_bytes(std::span(samples));
+	}
+
+	static Result<PCM> from_file(char const* path, FileFormat format = FileFormat::eUnknown, DecodeInfo const& info = {});
+	static Result<PCM> from_memory(std::span<std::byte const> bytes, FileFormat format, DecodeInfo const& info = {});
+	///
+	/// \brief Decode bytes pulled from reader (format is identified from its leading bytes if eUnknown)
+	///
+	/// Always decoded serially (DecodeInfo::threads is ignored)
+	///
+	static Result<PCM> from_reader(Reader& reader, FileFormat format = FileFormat::eUnknown, DecodeInfo const& info = {});
+
+	///
+	/// \brief Obtain a copy of this PCM converted to rate (same sample type, same memory resource)
+	///
+	/// Uses a vectorized polyphase resampler (SSE2 / AVX2 / NEON, detected at runtime)
+	///
+	Result<PCM> resample(SampleRate rate) const;
 
-	static Result<PCM> from_file(char const* path, FileFormat format = FileFormat::eUnknown);
-	static Result<PCM> from_memory(std::span<std::byte const> bytes, FileFormat format);
+	///
+	/// \brief Write samples to a capo file (FileFormat::eCapo) at path
+	///
+	Result<void> bake(char const* path) const;
 };
 
 class PCM::Streamer {
   public:
 	Streamer();
-	Streamer(char const* path);
+	Streamer(char const* path, SampleType type = SampleType::eS16);
 	Streamer(PCM pcm);
 	Streamer(Streamer&&) noexcept;
 	Streamer& operator=(Streamer&&) noexcept;
 	~Streamer() noexcept;
 
-	Result<void> open(char const* path);
-	void preload(PCM pcm) noexcept;
+	///
+	/// \brief Open a file at path for streaming; meta().format will be of the requested type
+	///
+	/// 16-bit PCM WAV and capo files are streamed out of a file mapping (without decoding); 16-bit samples are streamed as-is, regardless of type
+	///
+	Result<void> open(char const* path, SampleType type = SampleType::eS16);
+	///
+	/// \brief Open compressed bytes for streaming, decoding incrementally; format is identified from bytes if eUnknown
+	///
+	/// bytes are not copied: they must outlive this instance (or the next call to open / preload)
+	///
+	Result<void> open(std::span<std::byte const> bytes, FileFormat format = FileFormat::eUnknown, SampleType type = SampleType::eS16);
+	///
+	/// \brief Open reader for streaming, pulling bytes as required; format is identified from its leading bytes if eUnknown
+	///
+	/// reader must outlive this instance (or the next call to open / preload)
+	///
+	Result<void> open(Reader& reader, FileFormat format = FileFormat::eUnknown, SampleType type = SampleType::eS16);
+	void preload(PCM pcm);
+	///
+	/// \brief Stream shared (immutable) PCM, eg obtained from a PCMCache
+	///
+	void preload(std::shared_ptr<PCM const> pcm) noexcept;
+	///
+	/// \brief Resample to rate on read (0 => native rate), eg Instance::sample_rate(); persists across open / preload
+	///
+	/// meta() reports the resampled rate / frame count while active
+	///
+	void resample(SampleRate rate);
 	bool valid() const noexcept;
 	explicit operator bool() const noexcept { return valid(); }
 
@@ -49,14 +143,39 @@ class PCM::Streamer {
 	utils::Rate rate() const noexcept;
 	std::size_t remain() const noexcept;
 
+	///
+	/// \brief Read next samples into out_samples, converting from meta().format if necessary
+	///
 	std::size_t read(std::span<Sample> out_samples);
+	std::size_t read(std::span<SampleF32> out_samples);
 	Result<void> seek(Time stamp) noexcept;
 	std::size_t sample_count() const noexcept;
 	Time position() const noexcept;
 
+	///
+	/// \brief Check if read_view() is available (preloaded and not resampling)
+	///
+	bool viewable() const noexcept;
+	///
+	/// \brief Reference next (up to) max_samples preloaded samples in meta().format without copying; advances as read() does
+	///
+	/// Bytes are owned by preloaded_pcm(): hold a copy of it to keep them alive past the next open / preload
+	///
+	std::span<std::byte const> read_view(std::size_t max_samples) noexcept;
+	std::shared_ptr<PCM const> const& preloaded_pcm() const noexcept { return m_preloaded; }
+
   private:
 	struct File;
 	ktl::kunique_ptr<File> m_impl{};
-	std::vector<Sample> m_preloaded{};
+	std::shared_ptr<PCM const> m_preloaded{};
+
+	bool preloaded() const noexcept { return m_preloaded && !m_preloaded->data().empty(); }
+	std::size_t preloaded_count() const noexcept { return m_preloaded->data().size() / Metadata::sample_size(m_preloaded->meta.format); }
+	template <typename T>
+	std::size_t read_preloaded(std::span<T> out_samples);
+	template <typename T>
+	std::size_t read_source(std::span<T> out_samples);
+	template <typename T>
+	std::size_t read_resampled(std::span<T> out_samples);
 };
 } // namespace capo
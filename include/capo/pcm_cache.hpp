@@ -0,0 +1,51 @@
+#pragma once
+#include <capo/pcm.hpp>
+#include <ktl/kunique_ptr.hpp>
+#include <memory>
+
+namespace capo {
+///
+/// \brief Thread-safe cache of decoded PCM, keyed by file path (and the file's size / modification time)
+///
+/// Entries are shared and immutable; concurrent loads of the same path decode it once
+/// Least recently used entries are evicted once the total decoded size exceeds the byte budget
+/// (evicted PCM stays alive as long as it is referenced elsewhere)
+///
+class PCMCache {
+  public:
+	using Handle = std::shared_ptr<PCM const>;
+
+	struct Stats {
+		std::size_t hits{};
+		std::size_t misses{};
+		std::size_t evictions{};
+		std::size_t entries{};
+		std::size_t bytes{};
+	};
+
+	explicit PCMCache(std::size_t budget);
+	PCMCache(PCMCache&&) noexcept;
+	PCMCache& operator=(PCMCache&&) noexcept;
+	~PCMCache();
+
+	///
+	/// \brief Obtain decoded PCM for path, decoding it on a miss (or if the file has changed since it was cached)
+	///
+	/// Options in info are only used when decoding; the first load of a path determines its cached sample type
+	///
+	Result<Handle> load(char const* path, FileFormat format = FileFormat::eUnknown, DecodeInfo const& info = {});
+	bool evict(char const* path);
+	void clear();
+
+	///
+	/// \brief Set byte budget (evicts immediately if over)
+	///
+	void budget(std::size_t value);
+	std::size_t budget() const;
+	Stats stats() const;
+
+  private:
+	struct Impl;
+	ktl::kunique_ptr<Impl> m_impl{};
+};
+} // namespace capo
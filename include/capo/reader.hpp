@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <span>
+
+namespace capo {
+///
+/// \brief Interface for a source of encoded audio bytes (eg an entry in a packed archive / virtual filesystem)
+///
+/// Decoders pull bytes lazily through this interface, as required: the source is never read in full up front
+/// Positions are byte offsets relative to the start of the audio data
+/// Implementations must not throw (decoders invoke these from C callbacks)
+/// A Reader must outlive any PCM::Streamer / Music streaming from it
+///
+class Reader {
+  public:
+	virtual ~Reader() = default;
+
+	///
+	/// \brief Read up to out.size() bytes into out, returns number of bytes read (0 at end of data)
+	///
+	virtual std::size_t read(std::span<std::byte> out) = 0;
+	///
+	/// \brief Seek to position
+	///
+	virtual bool seek(std::size_t position) = 0;
+	///
+	/// \brief Obtain current position
+	///
+	virtual std::size_t tell() const = 0;
+};
+} // namespace capo
@@ -14,6 +14,10 @@ class Sound {
 	static Sound const blank;
 
 	Metadata const& meta() const noexcept { return m_meta; }
+	///
+	/// \brief Generational handle (see Instance::find_sound); stale once destroyed
+	///
+	UID id() const noexcept { return m_id; }
 	bool valid() const noexcept { return use_openal_v ? m_instance && m_buffer != 0 : valid_if_inactive_v; }
 	utils::Size size() const;
 	utils::Rate sample_rate() const noexcept;
@@ -21,9 +25,10 @@ class Sound {
 	bool operator==(Sound const& rhs) const noexcept { return m_instance == rhs.m_instance && m_buffer == rhs.m_buffer; }
 
   private:
-	Sound(Instance* instance, UID buffer, Metadata meta) noexcept : m_meta(meta), m_buffer(buffer), m_instance(instance) {}
+	Sound(Instance* instance, UID id, UID buffer, Metadata meta) noexcept : m_meta(meta), m_id(id), m_buffer(buffer), m_instance(instance) {}
 
 	Metadata m_meta{};
+	UID m_id{};
 	UID m_buffer{};
 	Instance* m_instance{};
 
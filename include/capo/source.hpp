@@ -17,6 +17,10 @@ class Source {
 	static Source const blank;
 
 	bool valid() const noexcept { return use_openal_v ? m_instance && m_handle > 0 : valid_if_inactive_v; }
+	///
+	/// \brief Generational handle (see Instance::find_source); stale once destroyed
+	///
+	UID id() const noexcept { return m_id; }
 	bool bind(Sound const& sound);
 	bool unbind();
 	Sound const& bound() const noexcept;
@@ -49,8 +53,9 @@ class Source {
 	bool operator==(Source const& rhs) const noexcept { return m_instance == rhs.m_instance && m_handle == rhs.m_handle; }
 
   private:
-	Source(Instance* instance, UID handle) noexcept : m_handle(handle), m_instance(instance) {}
+	Source(Instance* instance, UID id, UID handle) noexcept : m_id(id), m_handle(handle), m_instance(instance) {}
 
+	UID m_id{};
 	UID m_handle{};
 	Instance* m_instance{};
 
@@ -21,6 +21,7 @@ enum class Error {
 	eContextFailure,
 	eInvalidValue,
 	eUnknownFormat,
+	eCancelled,
 	eCOUNT_,
 };
 
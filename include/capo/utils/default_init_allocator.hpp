@@ -0,0 +1,42 @@
+#pragma once
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace capo::utils {
+///
+/// \brief Polymorphic allocator which default-initializes (instead of value-initializing) elements
+///
+/// vector::resize() of trivial T thus leaves new elements uninitialized rather than zero-filling them,
+/// which is wasted work when they are about to be overwritten (eg by a decoder)
+/// Allocates from any std::pmr::memory_resource (std::pmr::get_default_resource() if unspecified)
+///
+template <typename T>
+class DefaultInitAllocator : public std::pmr::polymorphic_allocator<T> {
+  public:
+	using Base = std::pmr::polymorphic_allocator<T>;
+	template <typename U>
+	struct rebind {
+		using other = DefaultInitAllocator<U>;
+	};
+
+	DefaultInitAllocator() = default;
+	DefaultInitAllocator(std::pmr::memory_resource* resource) noexcept : Base(resource ? resource : std::pmr::get_default_resource()) {}
+	template <typename U>
+	DefaultInitAllocator(DefaultInitAllocator<U> const& rhs) noexcept : Base(rhs.resource()) {}
+
+	template <typename U>
+	void construct(U* ptr) noexcept(std::is_nothrow_default_constructible_v<U>) {
+		::new (static_cast<void*>(ptr)) U;
+	}
+
+	template <typename U, typename... Args>
+	void construct(U* ptr, Args&&... args) {
+		Base::construct(ptr, std::forward<Args>(args)...);
+	}
+
+	// pmr semantics: container copies do not inherit the source's memory resource
+	DefaultInitAllocator select_on_container_copy_construction() const noexcept { return {}; }
+};
+} // namespace capo::utils
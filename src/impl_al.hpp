@@ -6,6 +6,7 @@
 #if defined(CAPO_USE_OPENAL)
 #include <AL/al.h>
 #include <AL/alc.h>
+#include <AL/alext.h>
 #endif
 #include <cassert>
 #include <iostream>
@@ -35,6 +36,8 @@ constexpr auto AL_BUFFERS_PROCESSED = 0x1016;
 constexpr auto AL_SEC_OFFSET = 0x1024;
 constexpr auto AL_FORMAT_MONO16 = 0x1101;
 constexpr auto AL_FORMAT_STEREO16 = 0x1103;
+constexpr auto AL_FORMAT_MONO_FLOAT32 = 0x10010;
+constexpr auto AL_FORMAT_STEREO_FLOAT32 = 0x10011;
 constexpr auto AL_SIZE = 0x2004;
 constexpr auto AL_BUFFER = 0x1009;
 #endif
@@ -42,7 +45,7 @@ constexpr auto AL_BUFFER = 0x1009;
 namespace capo::detail {
 using SamplesView = std::span<PCM::Sample const>;
 
-constexpr ALenum g_alFormats[] = {AL_FORMAT_MONO16, AL_FORMAT_STEREO16};
+constexpr ALenum g_alFormats[] = {AL_FORMAT_MONO16, AL_FORMAT_STEREO16, AL_FORMAT_MONO_FLOAT32, AL_FORMAT_STEREO_FLOAT32};
 constexpr ALenum al_format(capo::SampleFormat format) noexcept { return g_alFormats[static_cast<std::size_t>(format)]; }
 
 template <typename...>
@@ -63,6 +66,7 @@ constexpr utils::EnumStringView<Error> g_error_names = {
 	"Context Failure",
 	"Invalid Value",
 	"Unknown Format",
+	"Cancelled",
 };
 
 inline OnError g_on_error = [](Error error) { std::cerr << "[capo] Error: " << g_error_names[error] << std::endl; };
@@ -125,6 +129,28 @@ inline bool enumeration_extension_present() noexcept(false) {
 #endif
 }
 
+// float buffers (AL_FORMAT_*_FLOAT32) require AL_EXT_FLOAT32 on the current context
+inline bool float32_supported() noexcept(false) {
+#if defined(CAPO_USE_OPENAL)
+	return alIsExtensionPresent("AL_EXT_FLOAT32") == AL_TRUE;
+#else
+	return false;
+#endif
+}
+
+// sample type to upload / stream in: f32 if requested and supported, s16 otherwise
+inline SampleType upload_type(SampleType requested) noexcept(false) { return requested == SampleType::eF32 && float32_supported() ? SampleType::eF32 : SampleType::eS16; }
+
+inline SampleRate device_rate(MU ALCdevice* device) noexcept(false) {
+	SampleRate ret{};
+#if defined(CAPO_USE_OPENAL)
+	ALCint frequency{};
+	alcGetIntegerv(device, ALC_FREQUENCY, 1, &frequency);
+	if (frequency > 0) { ret = static_cast<SampleRate>(frequency); }
+#endif
+	return ret;
+}
+
 inline std::string_view device_name(MU ALCdevice* device) noexcept(false) {
 	std::string_view ret;
 #if defined(CAPO_USE_OPENAL)
@@ -235,11 +261,12 @@ void buffer_data(MU ALuint buffer, MU ALenum format, MU Cont const& data, MU std
 	CAPO_CHK(alBufferData(buffer, format, data.data(), static_cast<ALsizei>(data.size()) * sizeof(typename Cont::value_type), static_cast<ALsizei>(freq)));
 }
 
-inline void buffer_data(MU ALuint buffer, MU Metadata const& meta, MU SamplesView samples) noexcept(false) {
+// samples must be of meta.format
+inline void buffer_data(MU ALuint buffer, MU Metadata const& meta, MU std::span<std::byte const> samples) noexcept(false) {
 	buffer_data(buffer, al_format(meta.format), samples, meta.rate);
 }
 
-inline ALuint gen_buffer(MU Metadata const& meta, MU SamplesView samples) noexcept(false) {
+inline ALuint gen_buffer(MU Metadata const& meta, MU std::span<std::byte const> samples) noexcept(false) {
 	auto ret = gen_buffer();
 	buffer_data(ret, meta, samples);
 	return ret;
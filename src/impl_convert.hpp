@@ -0,0 +1,66 @@
+#pragma once
+#include <capo/pcm.hpp>
+#include <impl_simd.hpp>
+#include <algorithm>
+#include <cassert>
+#include <span>
+
+namespace capo::detail {
+constexpr float s16_to_f32(PCM::Sample const in) noexcept { return static_cast<float>(in) / 32768.0f; }
+constexpr PCM::Sample f32_to_s16(float const in) noexcept { return static_cast<PCM::Sample>(std::clamp(in * 32768.0f, -32768.0f, 32767.0f)); }
+
+///
+/// \brief Copy interleaved samples from in to out, converting sample type if necessary (vectorized, see impl_simd.hpp)
+///
+template <typename In, typename Out>
+void convert_samples(std::span<In const> in, std::span<Out> out) noexcept {
+	assert(out.size() >= in.size());
+	if constexpr (std::is_same_v<In, Out>) {
+		std::copy(in.begin(), in.end(), out.begin());
+	} else if constexpr (std::is_same_v<In, PCM::Sample>) {
+		kernels().s16_to_f32(in.data(), out.data(), in.size());
+	} else {
+		kernels().f32_to_s16(in.data(), out.data(), in.size());
+	}
+}
+
+///
+/// \brief Convert interleaved float frames between mono and stereo layouts (copy if channels match)
+///
+/// out must hold in_frames * out_channels samples
+///
+inline void convert_channels(std::span<float const> in, std::size_t in_channels, std::span<float> out, std::size_t out_channels) noexcept {
+	auto const frames = in.size() / in_channels;
+	assert(out.size() >= frames * out_channels);
+	if (in_channels == out_channels) {
+		std::copy(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(frames * in_channels), out.begin());
+	} else if (in_channels == 1) {
+		kernels().mono_to_stereo(in.data(), out.data(), frames);
+	} else {
+		kernels().stereo_to_mono(in.data(), out.data(), frames);
+	}
+}
+
+///
+/// \brief Multiply samples by gain in place
+///
+inline void apply_gain(std::span<float> samples, float const gain) noexcept {
+	if (gain != 1.0f) { kernels().gain(samples.data(), samples.size(), gain); }
+}
+
+///
+/// \brief Crossfade interleaved frames: out = out * gain + in * (1 - gain), gain ramping by step per frame
+///
+/// in may be shorter than out (treated as silence past its end)
+///
+inline void mix_ramp(std::span<float> out, std::span<float const> in, std::size_t const channels, float gain, float const step) noexcept {
+	auto const frames = out.size() / channels;
+	for (std::size_t frame = 0; frame < frames; ++frame, gain += step) {
+		auto const g = std::clamp(gain, 0.0f, 1.0f);
+		for (std::size_t c = 0; c < channels; ++c) {
+			auto const i = frame * channels + c;
+			out[i] = out[i] * g + (i < in.size() ? in[i] * (1.0f - g) : 0.0f);
+		}
+	}
+}
+} // namespace capo::detail
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <utility>
+#if defined(_WIN32)
+// not only defined for MSVC runtimes (see cmake/interface): keep min / max macros out of std::min / std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace capo::detail {
+///
+/// \brief Read-only memory mapping of an entire file
+///
+/// Pages are faulted in by the OS on access instead of being copied into an intermediate buffer
+/// Mapping is released on destruction; bytes() is empty if the file could not be mapped
+///
+class FileMap {
+  public:
+	FileMap() = default;
+
+	explicit FileMap(char const* path) noexcept {
+#if defined(_WIN32)
+		m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE) { return; }
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(m_file, &size) || size.QuadPart <= 0) { return; }
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping) { return; }
+		if (void* data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) {
+			m_data = static_cast<std::byte const*>(data);
+			m_size = static_cast<std::size_t>(size.QuadPart);
+		}
+#else
+		int const fd = ::open(path, O_RDONLY);
+		if (fd < 0) { return; }
+		struct stat st {};
+		if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+			auto const size = static_cast<std::size_t>(st.st_size);
+			if (void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0); data != MAP_FAILED) {
+				::posix_madvise(data, size, POSIX_MADV_SEQUENTIAL); // decoders read front to back
+				m_data = static_cast<std::byte const*>(data);
+				m_size = size;
+			}
+		}
+		::close(fd); // mapping remains valid after the descriptor is closed
+#endif
+	}
+
+	FileMap(FileMap&& rhs) noexcept : FileMap() { swap(*this, rhs); }
+	FileMap& operator=(FileMap rhs) noexcept { return (swap(*this, rhs), *this); }
+
+	~FileMap() noexcept {
+#if defined(_WIN32)
+		if (m_data) { UnmapViewOfFile(m_data); }
+		if (m_mapping) { CloseHandle(m_mapping); }
+		if (m_file != INVALID_HANDLE_VALUE) { CloseHandle(m_file); }
+#else
+		if (m_data) { ::munmap(const_cast<std::byte*>(m_data), m_size); }
+#endif
+	}
+
+	std::span<std::byte const> bytes() const noexcept { return {m_data, m_size}; }
+	bool valid() const noexcept { return m_data != nullptr; }
+	explicit operator bool() const noexcept { return valid(); }
+
+	friend void swap(FileMap& lhs, FileMap& rhs) noexcept {
+		std::swap(lhs.m_data, rhs.m_data);
+		std::swap(lhs.m_size, rhs.m_size);
+#if defined(_WIN32)
+		std::swap(lhs.m_file, rhs.m_file);
+		std::swap(lhs.m_mapping, rhs.m_mapping);
+#endif
+	}
+
+  private:
+	std::byte const* m_data{};
+	std::size_t m_size{};
+#if defined(_WIN32)
+	HANDLE m_file{INVALID_HANDLE_VALUE};
+	HANDLE m_mapping{};
+#endif
+};
+} // namespace capo::detail
@@ -0,0 +1,257 @@
+#pragma once
+#include <capo/pcm.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace capo::detail {
+using BytesView = std::span<std::byte const>;
+
+constexpr std::uint8_t byte_at(BytesView bytes, std::size_t index) noexcept { return index < bytes.size() ? std::to_integer<std::uint8_t>(bytes[index]) : 0; }
+
+constexpr bool has_tag(BytesView bytes, std::size_t offset, std::string_view tag) noexcept {
+	if (bytes.size() < offset + tag.size()) { return false; }
+	for (std::size_t i = 0; i < tag.size(); ++i) {
+		if (byte_at(bytes, offset + i) != static_cast<std::uint8_t>(tag[i])) { return false; }
+	}
+	return true;
+}
+
+template <typename T>
+constexpr T read_le(BytesView bytes, std::size_t offset) noexcept {
+	T ret{};
+	for (std::size_t i = 0; i < sizeof(T); ++i) { ret |= static_cast<T>(static_cast<T>(byte_at(bytes, offset + i)) << (8 * i)); }
+	return ret;
+}
+
+template <typename T>
+constexpr void write_le(std::span<std::byte> bytes, std::size_t offset, T const value) noexcept {
+	for (std::size_t i = 0; i < sizeof(T); ++i) { bytes[offset + i] = static_cast<std::byte>((value >> (8 * i)) & 0xff); }
+}
+
+///
+/// \brief Size of ID3v2 tag at the start of bytes (including header / footer), 0 if absent
+///
+constexpr std::size_t id3_size(BytesView bytes) noexcept {
+	if (!has_tag(bytes, 0, "ID3") || bytes.size() < 10) { return 0; }
+	// size is a 28-bit "syncsafe" integer: 7 bits per byte
+	std::size_t ret{};
+	for (std::size_t i = 6; i < 10; ++i) { ret = (ret << 7) | (byte_at(bytes, i) & 0x7f); }
+	bool const footer = (byte_at(bytes, 5) & 0x10) != 0;
+	return ret + (footer ? 20 : 10);
+}
+
+///
+/// \brief Check for a plausible MPEG audio frame header at offset
+///
+constexpr bool mpeg_sync(BytesView bytes, std::size_t offset) noexcept {
+	if (bytes.size() < offset + 4) { return false; }
+	auto const b1 = byte_at(bytes, offset + 1);
+	auto const b2 = byte_at(bytes, offset + 2);
+	if (byte_at(bytes, offset) != 0xff || (b1 & 0xe0) != 0xe0) { return false; }
+	bool const version_ok = ((b1 >> 3) & 0x3) != 0x1; // reserved
+	bool const layer_ok = ((b1 >> 1) & 0x3) != 0x0;   // reserved
+	bool const bitrate_ok = ((b2 >> 4) & 0xf) != 0xf; // bad
+	bool const rate_ok = ((b2 >> 2) & 0x3) != 0x3;	  // reserved
+	return version_ok && layer_ok && bitrate_ok && rate_ok;
+}
+
+template <typename T>
+constexpr T read_be(BytesView bytes, std::size_t offset) noexcept {
+	T ret{};
+	for (std::size_t i = 0; i < sizeof(T); ++i) { ret = static_cast<T>((ret << 8) | byte_at(bytes, offset + i)); }
+	return ret;
+}
+
+///
+/// \brief Offset of the first plausible MPEG audio frame header at / after offset (within scan bytes), bytes.size() if none
+///
+constexpr std::size_t mpeg_find_sync(BytesView bytes, std::size_t offset, std::size_t scan = 4096) noexcept {
+	for (std::size_t i = offset; i < offset + scan && i + 4 <= bytes.size(); ++i) {
+		if (mpeg_sync(bytes, i)) { return i; }
+	}
+	return bytes.size();
+}
+
+///
+/// \brief Identify audio container from its leading bytes (magic numbers)
+///
+/// Returns FileFormat::eUnknown if no supported signature is found
+///
+constexpr FileFormat probe_format(BytesView bytes) noexcept {
+	static_assert(static_cast<int>(FileFormat::eCOUNT_) == 5, "Unhandled file format");
+	constexpr std::size_t mpeg_scan_v = 4096; // tolerate some junk before the first MPEG frame
+	if (has_tag(bytes, 0, "CAPO")) { return FileFormat::eCapo; }
+	if ((has_tag(bytes, 0, "RIFF") || has_tag(bytes, 0, "RF64")) && has_tag(bytes, 8, "WAVE")) { return FileFormat::eWav; }
+	if (has_tag(bytes, 0, "riff")) { return FileFormat::eWav; } // Wave64 GUID
+	auto const tag = id3_size(bytes);
+	if (has_tag(bytes, tag, "fLaC")) { return FileFormat::eFlac; }
+	if (tag > 0 && tag < bytes.size()) { return FileFormat::eMp3; }
+	if (mpeg_find_sync(bytes, 0, mpeg_scan_v) < bytes.size()) { return FileFormat::eMp3; }
+	return FileFormat::eUnknown;
+}
+
+///
+/// \brief Interleaved samples located inside a file's bytes, in the layout alBufferData expects
+///
+struct RawPCM {
+	Metadata meta{};
+	BytesView data{};
+
+	template <typename T>
+	std::span<T const> samples() const noexcept {
+		return {reinterpret_cast<T const*>(data.data()), data.size() / sizeof(T)};
+	}
+};
+
+///
+/// \brief Locate the data chunk of a little-endian 16-bit mono / stereo PCM WAV
+///
+/// Such data is already in the layout alBufferData expects, and can be uploaded / streamed without decoding
+/// Returns nullopt for any other encoding (or on big-endian hosts)
+///
+constexpr std::optional<RawPCM> parse_pcm16_wav(BytesView bytes) noexcept {
+	constexpr std::uint16_t pcm_v = 0x1;
+	constexpr std::uint16_t extensible_v = 0xfffe;
+	if constexpr (std::endian::native != std::endian::little) { return std::nullopt; }
+	if (!has_tag(bytes, 0, "RIFF") || !has_tag(bytes, 8, "WAVE")) { return std::nullopt; }
+	std::optional<Metadata> meta;
+	for (std::size_t offset = 12; offset + 8 <= bytes.size();) {
+		auto const size = static_cast<std::size_t>(read_le<std::uint32_t>(bytes, offset + 4));
+		auto const body = offset + 8;
+		if (has_tag(bytes, offset, "fmt ") && size >= 16) {
+			auto tag = read_le<std::uint16_t>(bytes, body);
+			// WAVE_FORMAT_EXTENSIBLE: actual format tag is the first two bytes of the sub-format GUID
+			if (tag == extensible_v && size >= 40) { tag = read_le<std::uint16_t>(bytes, body + 24); }
+			auto const channels = static_cast<std::size_t>(read_le<std::uint16_t>(bytes, body + 2));
+			auto const rate = static_cast<std::size_t>(read_le<std::uint32_t>(bytes, body + 4));
+			auto const bits = read_le<std::uint16_t>(bytes, body + 14);
+			if (tag != pcm_v || bits != 16 || !Metadata::supported(channels) || rate == 0) { return std::nullopt; }
+			meta = Metadata{.rate = rate, .format = Metadata::make_format(channels, SampleType::eS16)};
+		} else if (has_tag(bytes, offset, "data")) {
+			if (!meta || body % alignof(PCM::Sample) != 0) { return std::nullopt; }
+			auto const frame_size = Metadata::channel_count(meta->format) * sizeof(PCM::Sample);
+			// clamp to what is actually present (truncated files / streaming writers leave size unset)
+			auto const available = std::min(size, bytes.size() - body);
+			meta->total_frame_count = available / frame_size;
+			return RawPCM{*meta, bytes.subspan(body, meta->total_frame_count * frame_size)};
+		}
+		offset = body + size + (size & 1); // chunks are word aligned
+	}
+	return std::nullopt;
+}
+
+///
+/// \brief capo file (FileFormat::eCapo): pre-decoded samples, loaded / streamed without decoding
+///
+/// Layout (little-endian): "CAPO" | u16 version | u16 SampleFormat | u32 rate | u64 total_frame_count | zero padding,
+/// followed by interleaved samples at capo_header_size_v (aligned for any sample type)
+///
+inline constexpr std::uint16_t capo_version_v = 1;
+inline constexpr std::size_t capo_header_size_v = 32;
+
+using CapoHeader = std::array<std::byte, capo_header_size_v>;
+
+constexpr CapoHeader make_capo_header(Metadata const& meta) noexcept {
+	auto ret = CapoHeader{};
+	for (std::size_t i = 0; i < 4; ++i) { ret[i] = static_cast<std::byte>("CAPO"[i]); }
+	write_le<std::uint16_t>(ret, 4, capo_version_v);
+	write_le<std::uint16_t>(ret, 6, static_cast<std::uint16_t>(meta.format));
+	write_le<std::uint32_t>(ret, 8, static_cast<std::uint32_t>(meta.rate));
+	write_le<std::uint64_t>(ret, 16, static_cast<std::uint64_t>(meta.total_frame_count));
+	return ret;
+}
+
+///
+/// \brief Parse the header of a capo file (total_frame_count as recorded)
+///
+/// Returns nullopt for an unsupported version / invalid header (or on big-endian hosts)
+///
+constexpr std::optional<Metadata> parse_capo_header(BytesView bytes) noexcept {
+	if constexpr (std::endian::native != std::endian::little) { return std::nullopt; }
+	if (!has_tag(bytes, 0, "CAPO") || bytes.size() < capo_header_size_v || read_le<std::uint16_t>(bytes, 4) != capo_version_v) { return std::nullopt; }
+	auto const format = read_le<std::uint16_t>(bytes, 6);
+	auto const rate = static_cast<std::size_t>(read_le<std::uint32_t>(bytes, 8));
+	if (format > static_cast<std::uint16_t>(SampleFormat::eStereoF32) || rate == 0) { return std::nullopt; }
+	auto const frames = static_cast<std::size_t>(read_le<std::uint64_t>(bytes, 16));
+	return Metadata{.rate = rate, .format = static_cast<SampleFormat>(format), .total_frame_count = frames};
+}
+
+constexpr std::size_t frame_size(SampleFormat format) noexcept { return Metadata::channel_count(format) * Metadata::sample_size(format); }
+
+///
+/// \brief Locate the samples of a capo file
+///
+constexpr std::optional<RawPCM> parse_capo(BytesView bytes) noexcept {
+	auto const meta = parse_capo_header(bytes);
+	if (!meta) { return std::nullopt; }
+	auto ret = RawPCM{.meta = *meta};
+	// clamp to what is actually present (truncated files)
+	ret.meta.total_frame_count = std::min(meta->total_frame_count, (bytes.size() - capo_header_size_v) / frame_size(meta->format));
+	ret.data = bytes.subspan(capo_header_size_v, ret.meta.total_frame_count * frame_size(meta->format));
+	return ret;
+}
+
+///
+/// \brief Locate samples which can be used without decoding (16-bit PCM WAV / capo file)
+///
+constexpr std::optional<RawPCM> parse_raw(BytesView bytes, FileFormat format) noexcept {
+	switch (format) {
+	case FileFormat::eWav: return parse_pcm16_wav(bytes);
+	case FileFormat::eCapo: return parse_capo(bytes);
+	default: return std::nullopt;
+	}
+}
+
+///
+/// \brief Decoded length of an MP3 from its headers, without decoding it
+///
+/// Uses the frame count in a Xing / Info (LAME) or VBRI header in the first frame if present;
+/// otherwise, if bytes is the whole file (complete), estimates a constant bitrate stream's length from its size
+/// bytes may start with an ID3v2 tag (or directly at the first frame)
+/// Returns nullopt if the length cannot be determined
+///
+constexpr std::optional<std::size_t> mp3_frame_count(BytesView bytes, bool complete) noexcept {
+	constexpr std::uint16_t rates_v[] = {44100, 48000, 32000};
+	/* clang-format off */
+	constexpr std::uint16_t bitrates_v[5][15] = {
+		{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448}, // MPEG1 L1
+		{0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},	   // MPEG1 L2
+		{0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},	   // MPEG1 L3
+		{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},	   // MPEG2 L1
+		{0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},		   // MPEG2 L2 / L3
+	};
+	/* clang-format on */
+	auto const frame = mpeg_find_sync(bytes, id3_size(bytes));
+	if (frame >= bytes.size()) { return std::nullopt; }
+	auto const b1 = byte_at(bytes, frame + 1);
+	auto const b2 = byte_at(bytes, frame + 2);
+	auto const b3 = byte_at(bytes, frame + 3);
+	auto const version = (b1 >> 3) & 0x3; // 3: MPEG1, 2: MPEG2, 0: MPEG2.5
+	auto const layer = 4 - ((b1 >> 1) & 0x3);
+	bool const mpeg1 = version == 3;
+	bool const mono = (b3 >> 6) == 0x3;
+	std::size_t const rate = rates_v[(b2 >> 2) & 0x3] >> (mpeg1 ? 0 : version == 2 ? 1 : 2);
+	std::size_t const samples = layer == 1 ? 384 : (layer == 3 && !mpeg1) ? 576 : 1152;
+
+	// Xing / Info: after the side information
+	auto const xing = frame + 4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17));
+	if ((has_tag(bytes, xing, "Xing") || has_tag(bytes, xing, "Info")) && (read_be<std::uint32_t>(bytes, xing + 4) & 0x1) != 0) {
+		return samples * read_be<std::uint32_t>(bytes, xing + 8);
+	}
+	// VBRI: fixed offset
+	if (has_tag(bytes, frame + 36, "VBRI")) { return samples * read_be<std::uint32_t>(bytes, frame + 36 + 14); }
+
+	auto const bitrate = std::size_t(bitrates_v[mpeg1 ? layer - 1 : (layer == 1 ? 3 : 4)][(b2 >> 4) & 0xf]) * 1000;
+	if (!complete || bitrate == 0) { return std::nullopt; }
+	auto end = bytes.size();
+	if (end >= frame + 128 && has_tag(bytes, end - 128, "TAG")) { end -= 128; } // ID3v1
+	auto const frames = (std::uint64_t(end - frame) * 8 * rate / bitrate + samples - 1) / samples;
+	return static_cast<std::size_t>(frames * samples);
+}
+} // namespace capo::detail
@@ -0,0 +1,174 @@
+#pragma once
+#include <capo/metadata.hpp>
+#include <impl_simd.hpp>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+namespace capo::detail {
+///
+/// \brief Streaming polyphase (windowed sinc) sample rate converter for interleaved float samples
+///
+/// Ratio is reduced to up / down (eg 44100 => 48000: 160 / 147); each output frame is a taps_v point dot product
+/// of input with one of (at most max_phases_v) precomputed filter phases, run on the vectorized kernels (impl_simd.hpp)
+/// Input is held planar per channel: the (taps_v - 1) frames of history needed across push() calls are retained
+///
+class Resampler {
+  public:
+	static constexpr std::size_t taps_v = 32;
+	static constexpr std::size_t max_phases_v = 1024;
+
+	static constexpr std::size_t output_frames(std::size_t input_frames, SampleRate from, SampleRate to) noexcept {
+		if (from == 0 || to == 0) { return input_frames; }
+		return static_cast<std::size_t>((std::uint64_t(input_frames) * to + from - 1) / from);
+	}
+
+	Resampler() = default;
+
+	Resampler(SampleRate from, SampleRate to, std::size_t channels) : m_channels(channels) {
+		assert(from > 0 && to > 0 && channels > 0 && channels <= m_input.size());
+		auto const divisor = std::gcd(from, to);
+		m_up = to / divisor;
+		m_down = from / divisor;
+		if (active()) { make_filter(); }
+		reset();
+	}
+
+	std::size_t output_frames(std::size_t input_frames) const noexcept { return output_frames(input_frames, m_down, m_up); }
+	bool active() const noexcept { return m_up != m_down; }
+	std::size_t channels() const noexcept { return m_channels; }
+
+	///
+	/// \brief Discard all buffered input (eg on seek)
+	///
+	void reset() {
+		for (auto& input : m_input) { input.assign(centre_v, 0.0f); }
+		m_index = m_phase = 0;
+		m_pushed = m_produced = 0;
+		m_flushed = false;
+	}
+
+	///
+	/// \brief Append interleaved input samples (whole frames)
+	///
+	void push(std::span<float const> samples) {
+		auto const frames = samples.size() / m_channels;
+		auto const start = m_input[0].size();
+		for (std::size_t c = 0; c < m_channels; ++c) { m_input[c].resize(start + frames); }
+		if (m_channels == 2) {
+			kernels().deinterleave(samples.data(), m_input[0].data() + start, m_input[1].data() + start, frames);
+		} else {
+			std::copy(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(frames), m_input[0].begin() + static_cast<std::ptrdiff_t>(start));
+		}
+		m_pushed += frames;
+	}
+
+	///
+	/// \brief Signal end of input: remaining buffered frames will be pulled
+	///
+	void flush() {
+		if (m_flushed) { return; }
+		for (std::size_t c = 0; c < m_channels; ++c) { m_input[c].resize(m_input[c].size() + centre_v + 1, 0.0f); }
+		m_flushed = true;
+	}
+
+	bool flushed() const noexcept { return m_flushed; }
+	bool drained() const noexcept { return m_flushed && m_produced >= output_frames(m_pushed); }
+
+	///
+	/// \brief Write as many interleaved output samples (whole frames) as possible into out
+	///
+	/// Returns number of samples written
+	///
+	std::size_t pull(std::span<float> out) {
+		auto const& kernel = kernels();
+		auto const available = m_input[0].size();
+		auto const total = output_frames(m_pushed);
+		std::size_t frames{};
+		for (auto const max = out.size() / m_channels; frames < max; ++frames) {
+			if (m_index + taps_v > available || (m_flushed && m_produced >= total)) { break; }
+			auto const* filter = m_filter.data() + (m_phase * m_phases / m_up) * taps_v;
+			for (std::size_t c = 0; c < m_channels; ++c) { out[frames * m_channels + c] = kernel.dot(m_input[c].data() + m_index, filter, taps_v); }
+			m_phase += m_down;
+			m_index += m_phase / m_up;
+			m_phase %= m_up;
+			++m_produced;
+		}
+		// drop input no longer in reach of the filter
+		if (m_index > 0) {
+			auto const consumed = std::min(m_index, available);
+			for (std::size_t c = 0; c < m_channels; ++c) { m_input[c].erase(m_input[c].begin(), m_input[c].begin() + consumed); }
+			m_index -= consumed;
+		}
+		return frames * m_channels;
+	}
+
+	///
+	/// \brief Number of output frames yet to be pulled, given input_frames yet to be pushed
+	///
+	std::size_t pending_frames(std::size_t input_frames) const noexcept {
+		auto const total = output_frames(m_pushed + input_frames);
+		return total > m_produced ? total - m_produced : 0;
+	}
+
+  private:
+	// filter is centred between taps (centre_v, centre_v + 1): input is offset by centre_v leading zeros
+	static constexpr std::size_t centre_v = taps_v / 2 - 1;
+
+	static double sinc(double x) noexcept {
+		constexpr double pi_v = 3.14159265358979323846;
+		return x == 0.0 ? 1.0 : std::sin(pi_v * x) / (pi_v * x);
+	}
+
+	// zeroth order modified Bessel function of the first kind
+	static double bessel_i0(double x) noexcept {
+		double ret = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; ++k) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			ret += term;
+		}
+		return ret;
+	}
+
+	void make_filter() {
+		constexpr double beta_v = 8.0;
+		// cutoff at the lower of the two Nyquist frequencies (with some transition band), relative to input rate
+		double const cutoff = 0.92 * std::min(1.0, double(m_up) / double(m_down));
+		m_phases = std::min(m_up, max_phases_v);
+		m_filter.resize(m_phases * taps_v);
+		for (std::size_t p = 0; p < m_phases; ++p) {
+			auto* phase = m_filter.data() + p * taps_v;
+			double const offset = double(p) / double(m_phases);
+			double sum{};
+			for (std::size_t k = 0; k < taps_v; ++k) {
+				double const d = double(k) - double(centre_v) - offset;
+				double const w = d / (double(taps_v) * 0.5);
+				double const window = std::abs(w) < 1.0 ? bessel_i0(beta_v * std::sqrt(1.0 - w * w)) / bessel_i0(beta_v) : 0.0;
+				double const h = cutoff * sinc(cutoff * d) * window;
+				phase[k] = float(h);
+				sum += h;
+			}
+			// unity gain at DC for every phase
+			for (std::size_t k = 0; k < taps_v; ++k) { phase[k] = float(phase[k] / sum); }
+		}
+	}
+
+	std::array<std::vector<float>, Metadata::max_channels_v> m_input{};
+	std::vector<float> m_filter{};
+	std::size_t m_channels{1};
+	std::size_t m_up{1};
+	std::size_t m_down{1};
+	std::size_t m_phases{1};
+	std::size_t m_index{};
+	std::size_t m_phase{};
+	std::uint64_t m_pushed{};
+	std::uint64_t m_produced{};
+	bool m_flushed{};
+};
+} // namespace capo::detail
@@ -0,0 +1,57 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace capo::detail {
+///
+/// \brief Fixed capacity single-producer single-consumer lock-free ring of T
+///
+/// Slots are reused in place (never constructed / destroyed): the producer fills acquire() and publishes it via commit(),
+/// the consumer reads front() and releases it via pop(); each side must be driven by at most one thread at a time
+///
+template <typename T, std::size_t Capacity>
+class SpscRing {
+	static_assert(Capacity > 0);
+
+  public:
+	static constexpr std::size_t capacity_v = Capacity;
+
+	///
+	/// \brief Producer: obtain the next vacant slot (nullptr if full)
+	///
+	T* acquire() noexcept {
+		auto const tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) == Capacity) { return nullptr; }
+		return &m_slots[tail % Capacity];
+	}
+	///
+	/// \brief Producer: publish the slot obtained via acquire()
+	///
+	void commit() noexcept { m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+	///
+	/// \brief Consumer: obtain the oldest published slot (nullptr if empty)
+	///
+	T* front() noexcept {
+		auto const head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire)) { return nullptr; }
+		return &m_slots[head % Capacity];
+	}
+	///
+	/// \brief Consumer: release the slot obtained via front()
+	///
+	void pop() noexcept { m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+	///
+	/// \brief Number of published slots (approximate while either side is active)
+	///
+	std::size_t size() const noexcept { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+
+  private:
+	std::array<T, Capacity> m_slots{};
+	// separate cache lines: each index is written by one side only
+	alignas(64) std::atomic<std::size_t> m_head{};
+	alignas(64) std::atomic<std::size_t> m_tail{};
+};
+} // namespace capo::detail
@@ -0,0 +1,87 @@
+#pragma once
+#include <ktl/async/kthread.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace capo::detail {
+///
+/// \brief Unit of streaming work driven by StreamScheduler
+///
+class StreamTask {
+  public:
+	using Clock = std::chrono::steady_clock;
+
+	///
+	/// \brief Decode / refill; returns when to be serviced next (nullopt: park until woken)
+	///
+	/// Never invoked concurrently for the same task; must not block on anything that waits for the scheduler
+	///
+	virtual std::optional<Clock::time_point> service() = 0;
+
+  protected:
+	~StreamTask() = default;
+};
+
+///
+/// \brief Process-wide fixed pool of threads servicing all streams, earliest deadline first
+///
+/// A task's deadline is when its queued buffers next need refilling: the stream closest to running dry is serviced first
+/// Thread count is constant regardless of the number of streams
+///
+class StreamScheduler {
+  public:
+	using Clock = StreamTask::Clock;
+
+	static StreamScheduler& instance();
+
+	StreamScheduler(StreamScheduler&&) = delete;
+	StreamScheduler& operator=(StreamScheduler&&) = delete;
+	~StreamScheduler();
+
+	///
+	/// \brief Register task (parked until woken)
+	///
+	void add(StreamTask& task);
+	///
+	/// \brief Unregister task: blocks while it is being serviced
+	///
+	void remove(StreamTask& task);
+	///
+	/// \brief Service task as soon as possible
+	///
+	void wake(StreamTask& task);
+
+	std::size_t stream_count() const;
+	std::size_t thread_count() const noexcept { return m_threads.size(); }
+
+  private:
+	struct State {
+		std::optional<Clock::time_point> deadline{};
+		bool running{};
+		bool rewake{};
+	};
+
+	StreamScheduler();
+
+	void schedule(StreamTask& task, State& state, Clock::time_point deadline);
+	void run(ktl::kthread::stop_t const& stop);
+
+	std::unordered_map<StreamTask*, State> m_tasks{};
+	std::set<std::pair<Clock::time_point, StreamTask*>> m_queue{};
+	std::condition_variable m_work{};
+	std::condition_variable m_done{};
+	mutable std::mutex m_mutex{};
+	bool m_stop{};
+
+	// must be destroyed first
+	std::vector<ktl::kthread> m_threads{};
+};
+} // namespace capo::detail
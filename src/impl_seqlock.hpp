@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace capo::detail {
+///
+/// \brief Single-writer sequence lock publishing snapshots of a trivially copyable T
+///
+/// Readers never block the writer (nor each other): a read that overlaps a write is retried
+/// Payload is held in relaxed atomic words: no data races, and no locks on platforms with lock-free 64-bit atomics
+/// Writers must be serialized externally
+///
+template <typename T>
+class SeqLock {
+	static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>);
+
+  public:
+	SeqLock() { store(T{}); }
+
+	void store(T const& value) noexcept {
+		auto words = Words{};
+		std::memcpy(words.data(), &value, sizeof(T));
+		auto const seq = m_seq.load(std::memory_order_relaxed);
+		m_seq.store(seq + 1, std::memory_order_relaxed); // odd: write in progress
+		std::atomic_thread_fence(std::memory_order_release);
+		for (std::size_t i = 0; i < words.size(); ++i) { m_words[i].store(words[i], std::memory_order_relaxed); }
+		m_seq.store(seq + 2, std::memory_order_release);
+	}
+
+	T load() const noexcept {
+		auto words = Words{};
+		while (true) {
+			auto const seq = m_seq.load(std::memory_order_acquire);
+			if (seq % 2 != 0) { continue; }
+			for (std::size_t i = 0; i < words.size(); ++i) { words[i] = m_words[i].load(std::memory_order_relaxed); }
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (m_seq.load(std::memory_order_relaxed) == seq) { break; }
+		}
+		T ret;
+		std::memcpy(static_cast<void*>(&ret), words.data(), sizeof(T));
+		return ret;
+	}
+
+  private:
+	using Words = std::array<std::uint64_t, (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t)>;
+
+	std::array<std::atomic<std::uint64_t>, Words{}.size()> m_words{};
+	std::atomic<std::uint32_t> m_seq{};
+};
+} // namespace capo::detail
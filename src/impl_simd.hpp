@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CAPO_SIMD_X86
+#endif
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#define CAPO_SIMD_NEON
+#endif
+
+namespace capo::detail {
+///
+/// \brief Instruction set used by vectorized kernels (highest supported, detected at runtime)
+///
+enum class SimdLevel { eScalar, eSse2, eAvx2, eNeon };
+
+constexpr std::string_view simd_name(SimdLevel level) noexcept {
+	switch (level) {
+	case SimdLevel::eSse2: return "SSE2";
+	case SimdLevel::eAvx2: return "AVX2";
+	case SimdLevel::eNeon: return "NEON";
+	default: return "Scalar";
+	}
+}
+
+///
+/// \brief Table of kernels for a SimdLevel
+///
+/// All pointers may be unaligned; counts are in samples, frames in (mono / stereo) frames
+///
+struct Kernels {
+	///
+	/// \brief Dot product of a and b (count floats each)
+	///
+	float (*dot)(float const* a, float const* b, std::size_t count) noexcept;
+	///
+	/// \brief Convert count 16-bit samples to float ([-1, 1))
+	///
+	void (*s16_to_f32)(std::int16_t const* in, float* out, std::size_t count) noexcept;
+	///
+	/// \brief Convert count float samples to 16-bit (clamped)
+	///
+	void (*f32_to_s16)(float const* in, std::int16_t* out, std::size_t count) noexcept;
+	///
+	/// \brief Duplicate each mono sample into a stereo frame
+	///
+	void (*mono_to_stereo)(float const* in, float* out, std::size_t frames) noexcept;
+	///
+	/// \brief Average each stereo frame into a mono sample
+	///
+	void (*stereo_to_mono)(float const* in, float* out, std::size_t frames) noexcept;
+	///
+	/// \brief Multiply count samples by gain (in place)
+	///
+	void (*gain)(float* data, std::size_t count, float gain) noexcept;
+	///
+	/// \brief Interleave left and right channels into stereo frames
+	///
+	void (*interleave)(float const* left, float const* right, float* out, std::size_t frames) noexcept;
+	///
+	/// \brief Split stereo frames into left and right channels
+	///
+	void (*deinterleave)(float const* in, float* left, float* right, std::size_t frames) noexcept;
+};
+
+///
+/// \brief Detected instruction set (queried once)
+///
+SimdLevel simd_level() noexcept;
+///
+/// \brief Kernels for level (falls back to scalar if level is unsupported on this build / CPU)
+///
+Kernels const& kernels(SimdLevel level) noexcept;
+///
+/// \brief Kernels for simd_level()
+///
+Kernels const& kernels() noexcept;
+} // namespace capo::detail
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace capo::detail {
+///
+/// \brief Map of T addressed by generational handles: O(1) insert / erase / lookup without hashing
+///
+/// A handle packs a slot index (low index_bits_v) and the slot's generation (high bits, never 0: a handle is never 0);
+/// erasing an entry bumps its slot's generation, so stale handles are rejected instead of aliasing the slot's next occupant
+/// Slots live in a deque and are reused via a free list: references to entries remain valid until they are erased
+///
+template <typename T>
+class SlotMap {
+  public:
+	using Handle = std::uint32_t;
+
+	static constexpr std::uint32_t index_bits_v = 20;
+	static constexpr std::uint32_t max_size_v = 1u << index_bits_v;
+
+	///
+	/// \brief Insert make(handle) (nullptr if full)
+	///
+	template <typename F>
+	T* insert(F make) {
+		if (m_free.empty()) {
+			if (m_slots.size() >= max_size_v) { return nullptr; }
+			m_free.push_back(static_cast<std::uint32_t>(m_slots.size()));
+			m_slots.emplace_back();
+		}
+		auto const index = m_free.back();
+		m_free.pop_back();
+		auto& slot = m_slots[index];
+		++m_size;
+		return &slot.value.emplace(make(to_handle(index, slot.generation)));
+	}
+
+	///
+	/// \brief Erase the entry at handle (false if stale / invalid)
+	///
+	bool erase(Handle handle) {
+		auto* slot = find_slot(handle);
+		if (!slot) { return false; }
+		slot->value.reset();
+		slot->generation = slot->generation + 1 > max_generation_v ? 1 : slot->generation + 1;
+		m_free.push_back(handle & index_mask_v);
+		--m_size;
+		return true;
+	}
+
+	T* find(Handle handle) noexcept {
+		auto* slot = find_slot(handle);
+		return slot ? &*slot->value : nullptr;
+	}
+
+	T const* find(Handle handle) const noexcept { return const_cast<SlotMap&>(*this).find(handle); }
+
+	///
+	/// \brief Call f(T const&) for each entry, in slot order
+	///
+	template <typename F>
+	void for_each(F f) const {
+		for (auto const& slot : m_slots) {
+			if (slot.value) { f(*slot.value); }
+		}
+	}
+
+	std::size_t size() const noexcept { return m_size; }
+	bool empty() const noexcept { return m_size == 0; }
+
+  private:
+	static constexpr std::uint32_t index_mask_v = max_size_v - 1;
+	static constexpr std::uint32_t max_generation_v = (1u << (32 - index_bits_v)) - 1;
+
+	struct Slot {
+		std::optional<T> value{};
+		std::uint32_t generation{1};
+	};
+
+	static constexpr Handle to_handle(std::uint32_t index, std::uint32_t generation) noexcept { return index | (generation << index_bits_v); }
+
+	Slot* find_slot(Handle handle) noexcept {
+		auto const index = handle & index_mask_v;
+		if (index >= m_slots.size()) { return nullptr; }
+		auto& slot = m_slots[index];
+		if (!slot.value || slot.generation != handle >> index_bits_v) { return nullptr; }
+		return &slot;
+	}
+
+	std::deque<Slot> m_slots{};
+	std::vector<std::uint32_t> m_free{};
+	std::size_t m_size{};
+};
+} // namespace capo::detail
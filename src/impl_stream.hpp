@@ -1,28 +1,147 @@
 #pragma once
+#include <capo/music.hpp>
 #include <impl_al.hpp>
-#include <ktl/async/kthread.hpp>
+#include <impl_convert.hpp>
+#include <impl_ring.hpp>
+#include <impl_scheduler.hpp>
+#include <impl_seqlock.hpp>
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <vector>
 
 namespace capo::detail {
 ///
-/// \brief One streaming unit
+/// \brief One streaming unit: storage for samples of either sample type
 ///
-template <std::size_t N>
-using StreamFrame = PCM::Sample[N];
+struct StreamFrame {
+	static_assert(sizeof(PCM::SampleF32) >= sizeof(PCM::Sample));
+
+	// dynamically allocated: suitably aligned for either sample type
+	std::vector<std::byte> storage;
+
+	template <typename T>
+	std::span<T> samples(std::size_t count) {
+		if (storage.size() < count * sizeof(PCM::SampleF32)) { storage.resize(count * sizeof(PCM::SampleF32)); }
+		return {reinterpret_cast<T*>(storage.data()), count};
+	}
+};
 
 ///
-/// \brief Ringbuffer of OpenAL buffers
+/// \brief Lock-free accumulator for Music::Stats::Histogram
+///
+class StreamHistogram {
+  public:
+	using Histogram = Music::Stats::Histogram;
+
+	void add(Time duration) noexcept {
+		auto const micros = static_cast<std::uint64_t>(std::max(duration.count(), 0.0f) * 1e6f);
+		auto const bucket = std::min(static_cast<std::size_t>(std::bit_width(micros)), Histogram::buckets_v - 1);
+		m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		for (auto max = m_max.load(std::memory_order_relaxed); micros > max && !m_max.compare_exchange_weak(max, micros, std::memory_order_relaxed);) {}
+	}
+
+	void reset() noexcept {
+		for (auto& bucket : m_buckets) { bucket.store(0, std::memory_order_relaxed); }
+		m_count.store(0, std::memory_order_relaxed);
+		m_max.store(0, std::memory_order_relaxed);
+	}
+
+	Histogram get() const noexcept {
+		auto ret = Histogram{};
+		for (std::size_t i = 0; i < Histogram::buckets_v; ++i) { ret.buckets[i] = m_buckets[i].load(std::memory_order_relaxed); }
+		ret.count = m_count.load(std::memory_order_relaxed);
+		ret.max = Time(float(m_max.load(std::memory_order_relaxed)) * 1e-6f);
+		return ret;
+	}
+
+  private:
+	std::array<std::atomic<std::uint64_t>, Histogram::buckets_v> m_buckets{};
+	std::atomic<std::uint64_t> m_count{};
+	std::atomic<std::uint64_t> m_max{};
+};
+
+///
+/// \brief Telemetry updated by the streaming path (relaxed atomics), read without locking
+///
+struct StreamStats {
+	std::atomic<std::uint64_t> underruns{};
+	std::atomic<std::size_t> min_queued{};
+	std::atomic<std::uint64_t> frames_decoded{};
+	std::atomic<std::uint64_t> bytes_read{};
+	StreamHistogram decode_time{};
+	StreamHistogram tick_latency{};
+
+	StreamStats() noexcept { reset(Music::Buffering{}.buffer_count); }
+
+	// buffers: number of buffers the stream queues (min_queued starts there)
+	void reset(std::size_t const buffers) noexcept {
+		underruns.store(0, std::memory_order_relaxed);
+		seed_queued(buffers);
+		frames_decoded.store(0, std::memory_order_relaxed);
+		bytes_read.store(0, std::memory_order_relaxed);
+		decode_time.reset();
+		tick_latency.reset();
+	}
+
+	void seed_queued(std::size_t const buffers) noexcept { min_queued.store(buffers, std::memory_order_relaxed); }
+
+	void queued(std::size_t count) noexcept {
+		for (auto min = min_queued.load(std::memory_order_relaxed); count < min && !min_queued.compare_exchange_weak(min, count, std::memory_order_relaxed);) {}
+	}
+
+	Music::Stats get() const noexcept {
+		return {
+			.underruns = underruns.load(std::memory_order_relaxed),
+			.min_queued = min_queued.load(std::memory_order_relaxed),
+			.frames_decoded = frames_decoded.load(std::memory_order_relaxed),
+			.bytes_read = bytes_read.load(std::memory_order_relaxed),
+			.decode_time = decode_time.get(),
+			.tick_latency = tick_latency.get(),
+		};
+	}
+};
+
+///
+/// \brief Published state of a StreamSource
+///
+struct StreamSnapshot {
+	Metadata meta{};
+	utils::Size size{};
+	Time position{};				  // at stamp
+	StreamTask::Clock::rep stamp{}; // time of publishing
+	float pitch{1.0f};
+	std::size_t queued{}; // streams yet to start playing
+	State state{State::eUnknown};
+	bool valid{};
+};
+
+///
+/// \brief Queue of OpenAL buffers (up to a runtime limit)
 ///
-template <std::size_t BufferCount>
 class StreamBuffer {
   public:
-	template <std::size_t FrameSize>
-	using Primer = StreamFrame<FrameSize>[BufferCount];
+	static constexpr std::size_t max_buffers_v = Music::Buffering::max_buffers_v;
+
+	// where an enqueued buffer's samples start: index of the first sample in its track, and the track
+	struct Mark {
+		std::size_t first{};
+		std::uint64_t track{};
+	};
 
 	StreamBuffer(ALuint source) : m_source(source) {
 		set_source_prop(m_source, AL_BUFFER, 0); // unbind any existing buffers
 		for (auto& buf : m_buffers) { buf = gen_buffer(); }
+		m_free.assign(std::begin(m_buffers), std::end(m_buffers));
 	}
 
 	~StreamBuffer() {
@@ -32,45 +151,57 @@ class StreamBuffer {
 		delete_buffers(m_buffers);
 	}
 
-	// prime all buffers and enqueue them
-	template <std::size_t FrameSize>
-	bool acquire(Primer<FrameSize> const& primer, Metadata const& meta) {
-		m_meta = meta;
-		std::size_t i{};
-		for (SamplesView const frame : primer) { buffer_data(m_buffers[i++], m_meta, frame); }
-		return push_buffers(m_source, m_buffers);
-	}
+	// format of samples to be enqueued
+	void meta(Metadata const& meta) { m_meta = meta; }
+	// maximum number of buffers to keep enqueued (surplus buffers are not re-queued once vacant)
+	void limit(std::size_t count) { m_limit = std::clamp(count, std::size_t(1), max_buffers_v); }
+	std::size_t limit() const { return m_limit; }
 
 	// dequeue all vacant buffers
 	std::size_t release() {
 		std::size_t ret{};
 		// unqueue all buffers
 		while (can_pop_buffer(m_source)) {
-			pop_buffer(m_source);
+			reclaim();
 			++ret;
 		}
 		return ret;
 	}
 
-	// number of buffers enqueued (0 when released / not primed, BufferCount when acquired / primed)
-	std::size_t queued() const { return static_cast<std::size_t>(get_source_prop<ALint>(m_source, AL_BUFFERS_QUEUED)); }
+	// number of buffers enqueued (including vacant ones)
+	std::size_t queued() const { return m_count; }
 	// number of enqueued buffers ready to be popped
 	std::size_t vacant() const { return static_cast<std::size_t>(get_source_prop<ALint>(m_source, AL_BUFFERS_PROCESSED)); }
 
-	// fill and enqueue next buffer if vacant
-	bool next(SamplesView samples) {
-		if (can_pop_buffer(m_source)) {		   // check if any buffers are vacant
-			auto buf = pop_buffer(m_source);   // pop vacant buffer
-			buffer_data(buf, m_meta, samples); // write next frame
-			ALuint const bufs[] = {buf};	   // prep buffer
-			push_buffers(m_source, bufs);	   // enqueue buffer
-			return true;
-		}
-		return false;
+	// fill and enqueue next buffer if under the limit after dequeueing vacant ones
+	bool next(std::span<std::byte const> samples, Mark const mark) {
+		while (can_pop_buffer(m_source)) { reclaim(); } // pop vacant buffers
+		if (m_count >= m_limit || m_free.empty()) { return false; }
+		auto const buf = m_free.back();
+		m_free.pop_back();
+		buffer_data(buf, m_meta, samples); // write next frame
+		ALuint const bufs[] = {buf};	   // prep buffer
+		push_buffers(m_source, bufs);	   // enqueue buffer
+		m_marks[(m_front + m_count++) % max_buffers_v] = mark;
+		return true;
 	}
 
+	// mark of the oldest enqueued buffer
+	std::optional<Mark> front() const { return m_count > 0 ? std::optional(m_marks[m_front]) : std::nullopt; }
+
   private:
-	ALuint m_buffers[BufferCount] = {};
+	void reclaim() {
+		m_free.push_back(pop_buffer(m_source));
+		m_front = (m_front + 1) % max_buffers_v;
+		if (m_count > 0) { --m_count; }
+	}
+
+	ALuint m_buffers[max_buffers_v] = {};
+	std::vector<ALuint> m_free;
+	Mark m_marks[max_buffers_v] = {};
+	std::size_t m_front{};
+	std::size_t m_count{};
+	std::size_t m_limit{max_buffers_v};
 	Metadata m_meta;
 	ALuint m_source;
 };
@@ -78,83 +209,218 @@ class StreamBuffer {
 ///
 /// \brief OpenAL source with streaming / queued buffers
 ///
-template <std::size_t BufferCount = 3, std::size_t FrameSize = 4096>
-class StreamSource {
+/// Serviced by the process-wide StreamScheduler: each service reads ahead from the streamer into a lock-free ring
+/// (twice as deep as the buffer queue, decoder), and copies ready frames into vacant OpenAL buffers (feeder, recovers from underruns)
+/// Control calls (seek / stop / position) never wait on the decoder: seeks are requested by bumping a generation,
+/// frames decoded for an older generation are discarded by the feeder
+/// While playing, the next service is due in about one frame's duration (at the current pitch);
+/// streams with nothing to do are parked until woken (play / seek / open)
+/// Position, state and metadata are published as a seqlock snapshot after every service / control call:
+/// queries read (and extrapolate) the snapshot without locking or touching OpenAL
+/// Streams can be queued to follow the current one: the decoder moves on to the next stream as soon as the current one
+/// has been decoded through, so the buffer queue is fed across the boundary without a gap (or a re-prime)
+/// A crossfade mixes the outgoing and incoming decoders into the same frames (per-sample gain ramp), feeding one source
+/// Preloaded samples already in the upload format are referenced by the ring (not copied) and uploaded straight from the shared PCM
+/// Buffer count and frame size are configured at runtime (Music::Buffering); adaptive buffering adds buffers after underruns
+/// and at high pitch, and removes the extra ones once playback has been stable for a while
+///
+class StreamSource : public StreamTask {
   public:
-	using Primer = typename StreamBuffer<BufferCount>::template Primer<FrameSize>;
+	using Snapshot = StreamSnapshot;
 
-	StreamSource() : m_buffer(m_source.value) { start(); }
+	StreamSource() : m_buffer(m_source.value) {
+		apply_buffering();
+		StreamScheduler::instance().add(*this);
+	}
+
+	~StreamSource() { StreamScheduler::instance().remove(*this); }
 
 	ALuint source() const noexcept { return m_source.value; }
-	void loop(bool value) noexcept { m_loop.store(value); }
+	void loop(bool value) noexcept {
+		m_loop.store(value);
+		wake();
+	}
 	bool looping() const noexcept { return m_loop.load(); }
 
+	void buffering(Music::Buffering const& value) {
+		std::scoped_lock lock(m_mutex, m_decode_mutex);
+		m_buffering = value;
+		m_extra_buffers = 0;
+		apply_buffering();
+		m_stats.seed_queued(m_buffer.limit());
+		wake();
+	}
+
+	Music::Buffering buffering() const {
+		Lock lock(m_mutex);
+		return m_buffering;
+	}
+
 	bool open(char const* path) {
-		std::scoped_lock lock(m_mutex);
-		return m_streamer.open(path).has_value();
+		std::scoped_lock lock(m_mutex, m_decode_mutex);
+		reset(lock);
+		// stream float samples where supported: decoders and the OpenAL Soft mixer work natively in float
+		return on_open(lock, m_streamer.open(path, upload_type(SampleType::eF32)).has_value());
 	}
 
-	void load(PCM pcm) {
-		std::scoped_lock lock(m_mutex);
+	// source: bytes / Reader
+	template <typename Source>
+	bool open(Source& source, FileFormat format) {
+		std::scoped_lock lock(m_mutex, m_decode_mutex);
+		reset(lock);
+		return on_open(lock, m_streamer.open(source, format, upload_type(SampleType::eF32)).has_value());
+	}
+
+	void load(std::shared_ptr<PCM const> pcm) {
+		std::scoped_lock lock(m_mutex, m_decode_mutex);
+		reset(lock);
 		m_streamer.preload(std::move(pcm));
+		on_open(lock, m_streamer.valid());
+	}
+
+	// args: path / (bytes, format) / (Reader, format) / shared PCM
+	// opened immediately; converted to the current stream's channel layout and rate (if different) on read
+	// seeks apply to the stream being heard (the decoder steps back if it has already moved on to the next one)
+	template <typename... Args>
+	bool enqueue(Args&&... args) {
+		auto streamer = PCM::Streamer{};
+		if (!open_streamer(streamer, std::forward<Args>(args)...)) { return false; }
+		std::scoped_lock lock(m_mutex, m_decode_mutex);
+		// nothing to follow: open instead
+		if (!m_valid) {
+			reset(lock);
+			m_streamer = std::move(streamer);
+			return on_open(lock, true);
+		}
+		if (streamer.meta().rate != m_meta.rate) { streamer.resample(m_meta.rate); }
+		m_tracks.push_back({streamer.meta(), streamer.size(), ++m_enqueued});
+		m_queue.push_back(std::move(streamer));
+		// resume decoding if the current stream has already been decoded through
+		m_ended.store(0);
+		wake();
+		publish(lock);
+		return true;
+	}
+
+	// args: as enqueue; opens instead if nothing is playing
+	// frames decoded ahead (not yet queued on the source) are discarded so the fade starts at the next buffer,
+	// from the track that buffer would have continued (even if the decoder has crossed a gapless boundary)
+	template <typename... Args>
+	bool crossfade(Time const duration, Args&&... args) {
+		auto streamer = PCM::Streamer{};
+		if (!open_streamer(streamer, std::forward<Args>(args)...)) { return false; }
+		std::scoped_lock lock(m_mutex, m_decode_mutex);
+		if (!m_valid || !m_active) {
+			reset(lock);
+			m_streamer = std::move(streamer);
+			return on_open(lock, true);
+		}
+		if (streamer.meta().rate != m_meta.rate) { streamer.resample(m_meta.rate); }
+		// fade out of the track last queued on the source, from where it was queued up to: the decoder may be ahead
+		// of it in the same stream, or have moved on to the next queued one already
+		if (restore_track(m_cursor_track) && m_streamer.valid()) {
+			m_streamer.seek(to_time(m_cursor));
+			m_decoded_generation = m_generation.fetch_add(1) + 1;
+		}
+		// drop queued streams, but keep the metadata of the outgoing track if it is not audible yet
+		m_queue.clear();
+		m_played.clear();
+		while (!m_tracks.empty() && m_tracks.back().id > m_cursor_track) { m_tracks.pop_back(); }
+		auto const frames = static_cast<std::size_t>(std::max(duration.count(), 0.0f) * float(m_meta.rate));
+		if (frames > 0) {
+			m_fade = Fade{.outgoing = std::move(m_streamer), .frames = frames};
+		} else {
+			m_fade.reset();
+		}
+		m_streamer = std::move(streamer);
+		m_drained = false;
+		m_tracks.push_back({m_streamer.meta(), m_streamer.size(), ++m_enqueued});
+		m_decoded_track = m_enqueued;
+		m_ended.store(0);
+		wake();
+		publish(lock);
+		return true;
 	}
 
 	bool play() {
-		std::scoped_lock lock(m_mutex);
-		return play(lock);
+		Lock lock(m_mutex);
+		auto const ret = play(lock);
+		publish(lock);
+		return ret;
 	}
 
 	bool stop() {
-		std::scoped_lock lock(m_mutex);
-		return stop(lock);
+		Lock lock(m_mutex);
+		auto const ret = stop(lock);
+		publish(lock);
+		return ret;
+	}
+
+	bool pause() {
+		Lock lock(m_mutex);
+		auto const ret = m_valid && pause_source(m_source.value);
+		publish(lock);
+		return ret;
+	}
+
+	bool pitch(float value) {
+		Lock lock(m_mutex);
+		auto const ret = set_source_prop(m_source.value, AL_PITCH, value);
+		publish(lock);
+		return ret;
 	}
 
 	bool playing() const { return get_source_prop<ALint>(m_source.value, AL_SOURCE_STATE) == AL_PLAYING; }
 	bool paused() const { return get_source_prop<ALint>(m_source.value, AL_SOURCE_STATE) == AL_PAUSED; }
 
 	bool rewind() {
-		std::scoped_lock lock(m_mutex);
-		// rewind stream
-		if (m_streamer.valid() && m_streamer.seek({}).has_value()) {
-			// rewind source
-			rewind_source(m_source.value);
-			return true;
-		}
-		return false;
+		Lock lock(m_mutex);
+		if (!m_valid) { return false; }
+		// rewind source: all queued buffers become vacant
+		rewind_source(m_source.value);
+		m_buffer.release();
+		m_active = false;
+		request_seek(lock, {});
+		publish(lock);
+		return true;
 	}
 
 	bool seek(Time stamp) {
-		std::scoped_lock lock(m_mutex);
+		Lock lock(m_mutex);
+		if (!m_valid) { return false; }
 		bool const resume = playing();
 		// stop even if paused (drain queue)
-		stop(lock);
-		bool const ret = m_streamer.valid() && m_streamer.seek(stamp).has_value();
+		stop_source(m_source.value);
+		m_buffer.release();
+		m_active = false;
+		request_seek(lock, stamp);
 		if (resume) { play(lock); }
-		return ret;
+		publish(lock);
+		return true;
 	}
 
-	Time position() const {
-		std::scoped_lock lock(m_mutex);
-		if (!m_streamer.valid()) { return Time(); }
-		// compute how many samples ahead of playback streamer.remain() is
-		auto const samplesAhead = (m_buffer.queued() - m_buffer.vacant() + (playing() || paused() ? 1 : 0)) * FrameSize;
-		// find corresponding progress along track
-		auto const progress = detail::stream_progress(m_streamer.sample_count(), m_streamer.remain() + samplesAhead);
-		// find source's position on current buffer
-		auto const offset = Time(get_source_prop<float>(m_source.value, AL_SEC_OFFSET));
-		return progress * m_streamer.meta().length() + offset;
+	Snapshot snapshot() const noexcept { return m_snapshot.load(); }
+
+	// extrapolated from the last snapshot while playing
+	Time position() const noexcept {
+		auto const snap = snapshot();
+		if (!snap.valid) { return Time(); }
+		if (snap.state != State::ePlaying) { return snap.position; }
+		auto const elapsed = Time(Clock::now() - Clock::time_point(Clock::duration(snap.stamp))) * snap.pitch;
+		auto const ret = snap.position + elapsed;
+		auto const length = snap.meta.length();
+		if (length <= Time() || ret <= length) { return ret; }
+		return m_loop.load() ? Time(std::fmod(ret.count(), length.count())) : length;
 	}
 
-	bool ready() const {
-		std::scoped_lock lock(m_mutex);
-		return m_streamer.valid();
-	}
+	bool ready() const noexcept { return snapshot().valid; }
+	// metadata of the stream (as opened)
+	Metadata meta() const noexcept { return snapshot().meta; }
+	utils::Size size() const noexcept { return snapshot().size; }
+	State state() const noexcept { return snapshot().state; }
+	std::size_t queued() const noexcept { return snapshot().queued; }
 
-	// immutable ref doesn't have to be used under> a lock, unlocking and returning is ok
-	PCM::Streamer const& streamer() const {
-		std::scoped_lock lock(m_mutex);
-		return m_streamer;
-	}
+	Music::Stats stats() const noexcept { return m_stats.get(); }
 
   private:
 	struct Source {
@@ -166,85 +432,492 @@ class StreamSource {
 			delete_sources(src);
 		}
 	};
-	using Lock = std::scoped_lock<std::mutex>;
 
-	// need to acquire before playback if true
-	bool empty(Lock const&) const { return m_buffer.queued() == 0; }
-	// need to release and re-acquire before playback if true
-	bool starved(Lock const&) const { return m_buffer.vacant() == BufferCount; }
+	// one decoded frame, tagged with the seek generation it was decoded for
+	// data points into frame, or directly into preloaded pcm (kept alive by pcm)
+	struct Chunk {
+		StreamFrame frame;
+		std::span<std::byte const> data{};
+		std::shared_ptr<PCM const> pcm{};
+		std::size_t first{};
+		std::uint64_t track{};
+		std::uint64_t generation{};
+	};
 
-	void release(Lock const&) {
-		[[maybe_unused]] std::size_t const d = m_buffer.release();
-		assert(m_buffer.queued() == 0);
+	// outgoing stream of a crossfade
+	struct Fade {
+		PCM::Streamer outgoing{};
+		std::size_t frames{};
+		std::size_t done{};
+	};
+
+	// stream the decoder has moved past, possibly still audible
+	struct Decoded {
+		std::uint64_t track{};
+		PCM::Streamer streamer{};
+	};
+
+	// stream queued to follow the current one
+	struct Track {
+		Metadata meta{};
+		utils::Size size{};
+		std::uint64_t id{};
+	};
+
+	using Lock = std::unique_lock<std::mutex>;
+	using OpenLock = std::scoped_lock<std::mutex, std::mutex>;
+
+	static constexpr Time min_sleep_v = std::chrono::milliseconds(1);
+	static constexpr Time max_sleep_v = std::chrono::milliseconds(100);
+	// adaptive buffering: extra buffers are removed one at a time after this long without underruns
+	static constexpr Time stable_v = std::chrono::seconds(10);
+	static constexpr std::size_t max_ring_v = 2 * StreamBuffer::max_buffers_v;
+
+	Time to_time(std::size_t sample) const {
+		auto const channels = Metadata::channel_count(m_meta.format);
+		return m_meta.rate > 0 ? Time(float(sample / channels) / float(m_meta.rate)) : Time();
+	}
+
+	static bool open_streamer(PCM::Streamer& out, char const* path) { return out.open(path, upload_type(SampleType::eF32)).has_value(); }
+
+	template <typename Source>
+	static bool open_streamer(PCM::Streamer& out, Source& source, FileFormat format) {
+		return out.open(source, format, upload_type(SampleType::eF32)).has_value();
 	}
 
-	bool acquire(Lock const&) {
-		Primer primer = {};
-		for (auto& frame : primer) { m_streamer.read(frame); }
-		return m_buffer.acquire(primer, m_streamer.meta());
+	static bool open_streamer(PCM::Streamer& out, std::shared_ptr<PCM const> pcm) {
+		out.preload(std::move(pcm));
+		return out.valid();
 	}
 
-	bool play(Lock const& lock) {
-		if (m_streamer.valid()) {
-			// rewind
-			if (m_streamer.remain() == 0 && !m_streamer.seek({})) { return false; }
-			// drain queue if starved (stopped by itself)
-			if (starved(lock)) { release(lock); }
-			// prime queue if cold start (not unpause)
-			if (empty(lock)) {
-				// prime buffers
-				if (!acquire(lock)) { return false; }
-				// prepare next frame for poll thread (which will copy it into next available buffer)
-				m_next = SamplesView(m_frame_storage, m_streamer.read(m_frame_storage));
+	// stop and drain source, discard decoded frames and queued streams
+	void reset(OpenLock const&) {
+		stop_source(m_source.value);
+		m_buffer.release();
+		m_active = false;
+		m_queue.clear();
+		m_played.clear();
+		m_tracks.clear();
+		m_fade.reset();
+		m_enqueued = m_decoded_track = m_cursor_track = 0;
+		m_audible_track.store(0);
+		m_seek_track.store(0);
+	}
+
+	bool on_open(OpenLock const& lock, bool const valid) {
+		m_valid = valid;
+		m_meta = m_source_meta = valid ? m_streamer.meta() : Metadata{};
+		m_size = valid ? m_streamer.size() : utils::Size();
+		// preloaded samples are converted on read if their type cannot be uploaded
+		m_meta.format = Metadata::make_format(Metadata::channel_count(m_meta.format), upload_type(Metadata::sample_type(m_meta.format)));
+		m_buffer.meta(m_meta);
+		apply_buffering();
+		m_stats.reset(m_buffer.limit());
+		m_cursor = 0;
+		// freshly opened streamer is already at the start: nothing to seek
+		m_seek_to.store(0.0f);
+		m_decoded_generation = m_generation.fetch_add(1) + 1;
+		m_drained = false;
+		m_ended.store(0);
+		wake();
+		publish(lock);
+		return valid;
+	}
+
+	void request_seek(Lock const&, Time stamp) {
+		auto const length = m_meta.length();
+		auto const ratio = length > Time() ? std::clamp(stamp / length, 0.0f, 1.0f) : 0.0f;
+		auto const channels = Metadata::channel_count(m_meta.format);
+		m_cursor = std::size_t(ratio * float(m_meta.total_frame_count)) * channels;
+		// seek within the track being heard, even if the decoder has moved on to the next queued one
+		m_cursor_track = m_audible_track.load();
+		m_seek_track.store(m_cursor_track);
+		// decoder picks up the target when it observes the new generation
+		m_seek_to.store(stamp.count());
+		m_generation.fetch_add(1);
+		wake();
+	}
+
+	// queries OpenAL: only called on streaming / control paths
+	template <typename L>
+	void publish(L const&) {
+		auto const state = source_state(m_source.value);
+		auto mark = StreamBuffer::Mark{m_cursor, m_cursor_track};
+		auto offset = Time();
+		// source's offset is relative to the oldest enqueued buffer
+		if (auto const front = m_buffer.front(); front && (state == State::ePlaying || state == State::ePaused)) {
+			mark = *front;
+			offset = Time(get_source_prop<float>(m_source.value, AL_SEC_OFFSET));
+		}
+		advance_track(mark.track);
+		m_audible_track.store(mark.track);
+		auto position = to_time(mark.first) + offset;
+		// offset may span buffers past the end of the track (looped, or the next queued one)
+		if (auto const length = m_meta.length(); length > Time() && position > length) {
+			position = m_loop.load() ? Time(std::fmod(position.count(), length.count())) : length;
+		}
+		m_snapshot.store({
+			.meta = m_source_meta,
+			.size = m_size,
+			.position = m_valid ? position : Time(),
+			.stamp = Clock::now().time_since_epoch().count(),
+			.pitch = get_source_prop<float>(m_source.value, AL_PITCH),
+			.queued = m_tracks.size(),
+			.state = state,
+			.valid = m_valid,
+		});
+	}
+
+	// playback has reached track: report its metadata
+	void advance_track(std::uint64_t const track) {
+		for (; !m_tracks.empty() && m_tracks.front().id <= track; m_tracks.pop_front()) {
+			auto const& next = m_tracks.front();
+			m_source_meta = next.meta;
+			m_size = next.size;
+			m_meta.total_frame_count = next.meta.total_frame_count;
+		}
+	}
+
+	// both mutexes must be held (or threads not yet started)
+	void apply_buffering() {
+		using Buffering = Music::Buffering;
+		auto const count = std::clamp(m_buffering.buffer_count, Buffering::min_buffers_v, Buffering::max_buffers_v);
+		auto frame = m_buffering.frame_size;
+		if (m_buffering.latency > Time() && m_meta.rate > 0) {
+			auto const samples = m_buffering.latency.count() * float(m_meta.rate) * float(Metadata::channel_count(m_meta.format));
+			frame = static_cast<std::size_t>(samples / float(count));
+		}
+		// whole (stereo) frames
+		frame = std::clamp(frame, Buffering::min_frame_size_v, Buffering::max_frame_size_v) / 2 * 2;
+		m_frame_size = frame;
+		set_buffer_count(count + m_extra_buffers);
+	}
+
+	void set_buffer_count(std::size_t count) {
+		m_buffer.limit(count);
+		m_ring_depth.store(std::min(2 * m_buffer.limit(), max_ring_v));
+	}
+
+	// adaptive buffering: pitch scales consumption rate, underruns call for more headroom
+	void adapt(Lock const&, float const pitch, bool const underrun) {
+		if (!m_buffering.adaptive) { return; }
+		auto const now = Clock::now();
+		auto const base = std::clamp(m_buffering.buffer_count, Music::Buffering::min_buffers_v, Music::Buffering::max_buffers_v);
+		auto const scaled = std::min(static_cast<std::size_t>(std::ceil(float(base) * std::max(pitch, 1.0f))), StreamBuffer::max_buffers_v);
+		if (underrun) {
+			m_extra_buffers = std::min(m_extra_buffers + 1, StreamBuffer::max_buffers_v - base);
+			m_stable_since = now;
+		} else if (m_extra_buffers > 0 && now - m_stable_since > stable_v) {
+			--m_extra_buffers;
+			m_stable_since = now;
+		}
+		set_buffer_count(std::max(scaled, base + m_extra_buffers));
+	}
+
+	// parked when there is nothing to stream: service as soon as possible
+	void wake() { StreamScheduler::instance().wake(*this); }
+
+	// oldest decoded frame of the current generation (stale frames are discarded)
+	Chunk* front(Lock const&) {
+		auto const generation = m_generation.load();
+		auto* ret = m_ring.front();
+		for (; ret && ret->generation != generation; ret = m_ring.front()) {
+			ret->pcm.reset();
+			m_ring.pop();
+		}
+		return ret;
+	}
+
+	bool ended() const { return m_ended.load() == m_generation.load(); }
+
+	// copy ready frames into vacant buffers; if wait, block until at least one frame is ready (or the stream has ended)
+	void fill(Lock const& lock, bool wait) {
+		while (true) {
+			auto const produced = m_produced.load();
+			auto* chunk = front(lock);
+			if (!chunk) {
+				if (!wait || ended()) { return; }
+				m_produced.wait(produced);
+				continue;
 			}
+			if (!m_buffer.next(chunk->data, {chunk->first, chunk->track})) { return; }
+			m_cursor = chunk->first + chunk->data.size() / Metadata::sample_size(m_meta.format);
+			m_cursor_track = chunk->track;
+			chunk->pcm.reset();
+			m_ring.pop();
+			wait = false;
+		}
+	}
+
+	bool play(Lock const& lock) {
+		if (!m_valid) { return false; }
+		if (playing()) { return true; }
+		// unpause
+		if (paused()) {
+			wake();
 			return play_source(m_source.value);
 		}
-		return false;
+		// restart if finished
+		if (ended() && !front(lock)) { request_seek(lock, {}); }
+		// drain queue if stopped by itself (played through / starved)
+		m_buffer.release();
+		m_active = true;
+		wake();
+		// prime queue: only a cold start (no frames decoded ahead yet) waits for the decoder
+		fill(lock, true);
+		return m_buffer.front() && play_source(m_source.value);
 	}
 
 	bool stop(Lock const& lock) {
-		if (m_streamer.valid() && stop_source(m_source.value)) {
+		if (m_valid && stop_source(m_source.value)) {
 			// drain queue
-			release(lock);
-			m_streamer.seek({});
+			m_buffer.release();
+			m_active = false;
+			request_seek(lock, {});
 			// return true even if seek fails; stop succeeded
 			return true;
 		}
 		return false;
 	}
 
-	void tick() {
-		std::scoped_lock lock(m_mutex);
-		// refresh next frame if queued into buffer
-		if (m_buffer.next(m_next)) { m_next = SamplesView(m_frame_storage, m_streamer.read(m_frame_storage)); }
-		// rewind if looping and stream has finished
-		if (m_loop.load() && m_streamer.remain() == 0) { m_streamer.seek({}); } // rewind
+	std::optional<Clock::time_point> service() final {
+		auto const now = Clock::now();
+		if (m_deadline) { m_stats.tick_latency.add(std::max(now - *m_deadline, Clock::duration{})); }
+		while (decode()) {}
+		// control call in progress (possibly waiting for decoded frames): retry shortly
+		Lock lock(m_mutex, std::try_to_lock);
+		auto const sleep = lock ? tick(lock) : std::optional(min_sleep_v);
+		if (lock) {
+			publish(lock);
+			lock.unlock();
+		}
+		// refill what the feeder consumed
+		while (decode()) {}
+		m_deadline = sleep ? std::optional(Clock::now() + std::chrono::duration_cast<Clock::duration>(*sleep)) : std::nullopt;
+		return m_deadline;
+	}
+
+	// feeder: only copies decoded frames into OpenAL buffers, returns how long to sleep for (nullopt: park until woken)
+	std::optional<Time> tick(Lock const& lock) {
+		if (!m_active) { return std::nullopt; }
+		if (paused()) { return std::nullopt; } // unpaused via play()
+		auto const pitch = std::max(get_source_prop<float>(m_source.value, AL_PITCH), 0.01f);
+		if (playing()) {
+			m_starved = false;
+			m_stats.queued(m_buffer.queued() - std::min(m_buffer.vacant(), m_buffer.queued()));
+			adapt(lock, pitch, false);
+			fill(lock, false);
+			// next buffer will have been consumed in about one frame's duration
+			auto const channels = Metadata::channel_count(m_meta.format);
+			auto const frame = m_meta.rate > 0 ? Time(float(m_frame_size / channels) / float(m_meta.rate)) / pitch : Time();
+			return std::clamp(frame, min_sleep_v, max_sleep_v);
+		}
+		// source ran dry: underrun if more frames are (or will be) available, else played through
+		auto const available = front(lock) != nullptr;
+		if (!available && ended()) {
+			m_active = false;
+			return std::nullopt;
+		}
+		if (!m_starved) {
+			m_starved = true;
+			m_stats.underruns.fetch_add(1, std::memory_order_relaxed);
+			m_stats.queued(0);
+			adapt(lock, pitch, true);
+		}
+		if (available) {
+			m_buffer.release();
+			fill(lock, false);
+			play_source(m_source.value);
+		}
+		// starved: retry as soon as the decoder catches up
+		return min_sleep_v;
 	}
 
-	void start() {
-		m_thread = ktl::kthread([this](ktl::kthread::stop_t stop) {
-			while (!stop.stop_requested()) {
-				tick();				   // lock mutex in here...
-				ktl::kthread::yield(); // then yield outside lock
+	// decoder: reads ahead into the ring, returns false if there was nothing to do
+	bool decode() {
+		std::scoped_lock lock(m_decode_mutex);
+		auto const generation = m_generation.load();
+		if (generation != m_decoded_generation) {
+			m_decoded_generation = generation;
+			m_drained = false;
+			restore_track(m_seek_track.load());
+			if (m_streamer.valid()) { m_streamer.seek(Time(m_seek_to.load())); }
+		}
+		if (!m_streamer.valid() || (m_ended.load() == generation && !m_loop.load())) { return false; }
+		if (m_ring.size() >= m_ring_depth.load()) { return false; }
+		auto* chunk = m_ring.acquire();
+		if (!chunk) { return false; }
+		// a short read also ends the stream: estimated (MP3) lengths may be too long, data may be truncated
+		if (m_streamer.remain() == 0 || m_drained) {
+			m_drained = false;
+			if (m_loop.load()) {
+				// rewind if looping and stream has finished
+				m_streamer.seek({});
+			} else {
+				next_stream();
 			}
-		});
-		m_thread.m_join = ktl::kthread::policy::stop;
+		}
+		auto const start = Clock::now();
+		read_chunk(*chunk);
+		// stream ran dry before its reported length: move on to the next one (if any) before ending
+		while (chunk->data.empty() && !m_loop.load() && next_stream()) { read_chunk(*chunk); }
+		auto const size = chunk->data.size();
+		m_drained = size < m_frame_size * Metadata::sample_size(m_meta.format);
+		m_stats.decode_time.add(Clock::now() - start);
+		m_stats.frames_decoded.fetch_add(1, std::memory_order_relaxed);
+		m_stats.bytes_read.fetch_add(size, std::memory_order_relaxed);
+		if (size == 0) {
+			m_ended.store(generation);
+		} else {
+			chunk->generation = generation;
+			m_ring.commit();
+			m_ended.store(0);
+		}
+		m_produced.fetch_add(1);
+		m_produced.notify_all();
+		return size > 0;
+	}
+
+	// move on to the next queued stream without a gap
+	bool next_stream() {
+		if (m_queue.empty()) { return false; }
+		// retained while (possibly) audible: seeks / crossfades apply to the track being heard
+		auto const audible = m_audible_track.load();
+		while (!m_played.empty() && (m_played.front().track < audible || m_played.size() >= max_ring_v)) { m_played.pop_front(); }
+		m_played.push_back({m_decoded_track, std::move(m_streamer)});
+		m_streamer = std::move(m_queue.front());
+		m_queue.pop_front();
+		++m_decoded_track;
+		return true;
+	}
+
+	// make track (moved past by the decoder) current again, rewinding the streams after it back into the queue
+	bool restore_track(std::uint64_t const track) {
+		if (track == m_decoded_track) { return true; }
+		auto const it = std::find_if(m_played.begin(), m_played.end(), [track](Decoded const& d) { return d.track == track; });
+		if (it == m_played.end()) { return false; }
+		auto later = std::vector<PCM::Streamer>{};
+		for (auto next = it + 1; next != m_played.end(); ++next) { later.push_back(std::move(next->streamer)); }
+		later.push_back(std::move(m_streamer));
+		for (auto& streamer : later) { streamer.seek({}); }
+		m_queue.insert(m_queue.begin(), std::make_move_iterator(later.begin()), std::make_move_iterator(later.end()));
+		m_streamer = std::move(it->streamer);
+		m_played.erase(it, m_played.end());
+		m_decoded_track = track;
+		return true;
+	}
+
+	void read_chunk(Chunk& out) {
+		auto const channels = Metadata::channel_count(m_streamer.meta().format);
+		auto const decoded = m_streamer.sample_count() - std::min(m_streamer.remain(), m_streamer.sample_count());
+		out.first = decoded / channels * Metadata::channel_count(m_meta.format);
+		out.track = m_decoded_track;
+		out.data = read(out);
+	}
+
+	template <typename T>
+	std::span<std::byte const> read(StreamFrame& out) {
+		auto const samples = out.template samples<T>(m_frame_size);
+		if (!m_fade && Metadata::channel_count(m_streamer.meta().format) == Metadata::channel_count(m_meta.format)) {
+			return std::as_bytes(samples.first(m_streamer.read(samples)));
+		}
+		// crossfading / queued stream of a different channel layout: mix in float
+		m_mix.resize(samples.size());
+		auto count = read_float(m_streamer, std::span(m_mix));
+		if (m_fade) { count = mix_fade(std::span(m_mix), count); }
+		convert_samples(std::span<float const>(m_mix).first(count), samples);
+		return std::as_bytes(samples.first(count));
 	}
 
-	// huge buffer on top
-	StreamFrame<FrameSize> m_frame_storage;
+	// read float samples from streamer in the upload channel layout, returns number of samples written
+	std::size_t read_float(PCM::Streamer& streamer, std::span<float> out) {
+		auto const in_channels = Metadata::channel_count(streamer.meta().format);
+		auto const out_channels = Metadata::channel_count(m_meta.format);
+		if (in_channels == out_channels) { return streamer.read(out); }
+		m_convert.resize(out.size() / out_channels * in_channels);
+		auto const read = streamer.read(std::span(m_convert)) / in_channels * in_channels;
+		convert_channels(std::span<float const>(m_convert).first(read), in_channels, out, out_channels);
+		return read / in_channels * out_channels;
+	}
+
+	// mix the outgoing stream into the first count samples (incoming) of mix, returns number of samples written
+	std::size_t mix_fade(std::span<float> mix, std::size_t const count) {
+		auto& fade = *m_fade;
+		auto const channels = Metadata::channel_count(m_meta.format);
+		auto const frames = std::min(mix.size() / channels, fade.frames - fade.done);
+		auto const faded = frames * channels;
+		m_outgoing.resize(faded);
+		auto const outgoing = read_float(fade.outgoing, std::span(m_outgoing));
+		// incoming may run out within the fade: silence
+		if (count < faded) { std::fill(mix.begin() + static_cast<std::ptrdiff_t>(count), mix.begin() + static_cast<std::ptrdiff_t>(faded), 0.0f); }
+		auto const step = 1.0f / float(fade.frames);
+		mix_ramp(mix.first(faded), std::span<float const>(m_outgoing).first(outgoing), channels, float(fade.done) * step, step);
+		fade.done += frames;
+		if (fade.done >= fade.frames) { m_fade.reset(); }
+		return std::max(count, faded);
+	}
+
+	// read next frame from streamer, in the sample type to upload
+	std::span<std::byte const> read(Chunk& out) {
+		auto const& meta = m_streamer.meta();
+		// preloaded samples already in the upload format: reference them (buffer_data copies once, into OpenAL)
+		if (!m_fade && m_streamer.viewable() && meta.format == m_meta.format) {
+			out.pcm = m_streamer.preloaded_pcm();
+			return m_streamer.read_view(m_frame_size);
+		}
+		out.pcm.reset();
+		return Metadata::sample_type(m_meta.format) == SampleType::eF32 ? read<PCM::SampleF32>(out.frame) : read<PCM::Sample>(out.frame);
+	}
+
+	SpscRing<Chunk, max_ring_v> m_ring;
 
 	// "dependent" types, order matters
 	Source m_source;
-	StreamBuffer<BufferCount> m_buffer;
+	StreamBuffer m_buffer;
 
-	// regular members
+	// decoder state (guarded by m_decode_mutex)
 	PCM::Streamer m_streamer;
-	SamplesView m_next;
+	std::deque<PCM::Streamer> m_queue;
+	std::deque<Decoded> m_played;
+	std::optional<Fade> m_fade;
+	std::vector<float> m_mix;
+	std::vector<float> m_convert;
+	std::vector<float> m_outgoing;
+	std::uint64_t m_decoded_generation{};
+	std::uint64_t m_decoded_track{};
+	bool m_drained{}; // last read came up short: stream has ended
+	mutable std::mutex m_decode_mutex;
+
+	// feeder / control state (guarded by m_mutex)
+	Metadata m_meta; // format to upload
+	Metadata m_source_meta;
+	utils::Size m_size;
+	std::size_t m_cursor{}; // index of the next sample to be enqueued
+	std::uint64_t m_cursor_track{};
+	std::deque<Track> m_tracks; // queued, not yet playing
+	std::uint64_t m_enqueued{};
+	Music::Buffering m_buffering{};
+	std::size_t m_frame_size{}; // (also read by decoder: modified under both mutexes)
+	std::size_t m_extra_buffers{};
+	Clock::time_point m_stable_since{};
+	bool m_valid{};
+	bool m_starved{};
+	bool m_active{}; // playback requested: feeder keeps the queue topped up and recovers from underruns
 	mutable std::mutex m_mutex;
+
+	// shared
+	std::atomic<std::uint64_t> m_generation{1};
+	std::atomic<std::uint64_t> m_ended{};
+	std::atomic<std::uint32_t> m_produced{};
+	std::atomic<float> m_seek_to{};
+	std::atomic<std::uint64_t> m_seek_track{};
+	std::atomic<std::uint64_t> m_audible_track{}; // track of the oldest enqueued buffer (as of the last publish)
+	std::atomic<std::size_t> m_ring_depth{};
 	std::atomic_bool m_loop;
+	StreamStats m_stats;
+	SeqLock<Snapshot> m_snapshot;
 
-	// must be destroyed first
-	ktl::kthread m_thread;
+	// scheduler state (only accessed in service())
+	std::optional<Clock::time_point> m_deadline{};
 };
 } // namespace capo::detail
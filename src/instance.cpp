@@ -3,29 +3,68 @@
 #include <capo/sound.hpp>
 #include <capo/source.hpp>
 #include <impl_al.hpp>
+#include <impl_convert.hpp>
+#include <impl_file.hpp>
+#include <impl_format.hpp>
+#include <impl_scheduler.hpp>
+#include <impl_slot_map.hpp>
 #include <ktl/async/kthread.hpp>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace capo {
 struct Instance::Impl {
+	// forward and reverse indices (ids), kept in sync: all operations are O(1) (O(bound sources) to erase a Sound)
 	struct Bindings {
-		// Sound => Source
-		std::unordered_map<UID::type, std::unordered_set<UID::type>> map;
+		// Sound => Sources
+		std::unordered_map<UID::type, std::unordered_set<UID::type>> sources;
+		// Source => Sound
+		std::unordered_map<UID::type, UID::type> sounds;
 
 		void bind(Sound const& sound, Source const& source) {
 			unbind(source);
-			map[sound.m_buffer].insert(source.m_handle);
+			sources[sound.m_id].insert(source.m_id);
+			sounds.insert_or_assign(source.m_id, sound.m_id);
 		}
 
 		void unbind(Source const& source) {
-			for (auto& [_, set] : map) { set.erase(source.m_handle); }
+			auto const it = sounds.find(source.m_id);
+			if (it == sounds.end()) { return; }
+			if (auto set = sources.find(it->second); set != sources.end()) {
+				set->second.erase(source.m_id);
+				if (set->second.empty()) { sources.erase(set); }
+			}
+			sounds.erase(it);
+		}
+
+		// returns bound sources
+		std::unordered_set<UID::type> erase(Sound const& sound) {
+			auto const it = sources.find(sound.m_id);
+			if (it == sources.end()) { return {}; }
+			auto ret = std::move(it->second);
+			sources.erase(it);
+			for (auto const id : ret) { sounds.erase(id); }
+			return ret;
+		}
+
+		UID::type bound(Source const& source) const {
+			auto const it = sounds.find(source.m_id);
+			return it == sounds.end() ? UID::type{} : it->second;
 		}
 	};
 
+	// AL names are recycled by the implementation: entries are addressed by generational ids instead
+	Sound const& add_sound(Instance* instance, ALuint buffer, Metadata const& meta) {
+		if (auto const* ret = sounds.insert([&](UID::type id) { return Sound(instance, id, buffer, meta); })) { return *ret; }
+		ALuint const buf[] = {buffer};
+		detail::delete_buffers(buf);
+		detail::on_error(Error::eInvalidValue);
+		return Sound::blank;
+	}
+
 	Bindings bindings{};
-	std::unordered_map<UID::type, Sound> sounds{};
-	std::unordered_map<UID::type, Source> sources{};
+	detail::SlotMap<Sound> sounds{};
+	detail::SlotMap<Source> sources{};
 	ALCdevice* device{};
 	ALCcontext* context{};
 };
@@ -64,16 +103,14 @@ Instance::~Instance() {
 #if defined(CAPO_USE_OPENAL)
 	if (valid()) {
 		std::vector<ALuint> resources;
-		auto fill = [&resources](auto const& map) {
-			resources.clear();
-			resources.reserve(map.size());
-			for (auto const& [id, _] : map) { resources.push_back(id); }
-		};
 		// delete all sources, implicitly unbinding all buffers
-		fill(m_impl->sources);
+		resources.reserve(m_impl->sources.size());
+		m_impl->sources.for_each([&resources](Source const& source) { resources.push_back(source.m_handle); });
 		detail::delete_sources(resources);
 		// delete all buffers
-		fill(m_impl->sounds);
+		resources.clear();
+		resources.reserve(m_impl->sounds.size());
+		m_impl->sounds.for_each([&resources](Sound const& sound) { resources.push_back(sound.m_buffer); });
 		detail::delete_buffers(resources);
 		// destroy context and close device
 		detail::close_device(m_impl->context, m_impl->device);
@@ -85,62 +122,99 @@ bool Instance::valid() const noexcept { return use_openal_v ? m_impl->device &&
 
 Sound const& Instance::make_sound(PCM const& pcm) {
 	if (valid()) {
-		auto buffer = detail::gen_buffer(pcm.meta, pcm.samples);
-		auto [it, _] = m_impl->sounds.insert_or_assign(buffer, Sound(this, buffer, pcm.meta));
-		return it->second;
+		auto meta = pcm.meta;
+		auto const type = Metadata::sample_type(meta.format);
+		ALuint buffer{};
+		if (detail::upload_type(type) != type) {
+			// no AL_EXT_FLOAT32: narrow samples to 16-bit for upload
+			auto samples = std::vector<PCM::Sample>(pcm.samples_f32.size());
+			detail::convert_samples(std::span<PCM::SampleF32 const>(pcm.samples_f32), std::span(samples));
+			meta.format = Metadata::make_format(Metadata::channel_count(meta.format), SampleType::eS16);
+			buffer = detail::gen_buffer(meta, std::as_bytes(std::span(samples)));
+		} else {
+			buffer = detail::gen_buffer(meta, pcm.data());
+		}
+		return m_impl->add_sound(this, buffer, meta);
 	}
 	return Sound::blank;
 }
 
+Sound const& Instance::make_sound(std::span<std::byte const> bytes) {
+	if (valid()) {
+		// zero-decode fast path: upload samples (16-bit PCM WAV data chunk / capo file body) directly from bytes
+		auto const raw = detail::parse_raw(bytes, detail::probe_format(bytes));
+		if (raw && detail::upload_type(Metadata::sample_type(raw->meta.format)) == Metadata::sample_type(raw->meta.format)) {
+			return m_impl->add_sound(this, detail::gen_buffer(raw->meta, raw->data), raw->meta);
+		}
+		auto pcm = PCM::from_memory(bytes, FileFormat::eUnknown);
+		if (pcm) { return make_sound(*pcm); }
+		detail::on_error(pcm.error());
+	}
+	return Sound::blank;
+}
+
+Sound const& Instance::make_sound(char const* path) {
+	if (auto const map = detail::FileMap(path)) { return make_sound(map.bytes()); }
+	// could not map file: decode it through the regular path
+	auto pcm = PCM::from_file(path);
+	if (pcm) { return make_sound(*pcm); }
+	detail::on_error(pcm.error());
+	return Sound::blank;
+}
+
 Source const& Instance::make_source() {
 	if (valid()) {
-		auto source = detail::gen_source();
-		auto [it, _] = m_impl->sources.insert_or_assign(source, Source(this, source));
-		return it->second;
+		auto const source = detail::gen_source();
+		if (auto const* ret = m_impl->sources.insert([&](UID::type id) { return Source(this, id, source); })) { return *ret; }
+		ALuint const src[] = {source};
+		detail::delete_sources(src);
+		detail::on_error(Error::eInvalidValue);
 	}
 	return Source::blank;
 }
 
 bool Instance::destroy(Sound const& sound) {
-	if (valid() && sound.valid()) {
+	// stale handles (already destroyed) must not touch a recycled AL name
+	if (valid() && sound.valid() && m_impl->sounds.find(sound.m_id)) {
 		// unbind all sources
-		for (UID const src : m_impl->bindings.map[sound.m_buffer]) { detail::set_source_prop(src, AL_BUFFER, 0); }
+		for (auto const id : m_impl->bindings.erase(sound)) {
+			if (auto const* source = m_impl->sources.find(id)) { detail::set_source_prop(source->m_handle, AL_BUFFER, 0); }
+		}
 		// delete buffer
 		ALuint const buf[] = {sound.m_buffer};
 		detail::delete_buffers(buf);
 		// unmap buffer
-		m_impl->bindings.map.erase(sound.m_buffer);
-		m_impl->sounds.erase(sound.m_buffer);
+		m_impl->sounds.erase(sound.m_id);
 		return true;
 	}
 	return false;
 }
 
 bool Instance::destroy(Source const& source) {
-	if (valid() && source.valid()) {
+	if (valid() && source.valid() && m_impl->sources.find(source.m_id)) {
 		// delete source (implicitly unbinds buffer)
 		ALuint const src[] = {source.m_handle};
 		detail::delete_sources(src);
 		// unmap source
 		m_impl->bindings.unbind(source);
-		m_impl->sources.erase(source.m_handle);
+		m_impl->sources.erase(source.m_id);
 		return true;
 	}
 	return false;
 }
 
 Sound const& Instance::find_sound(UID id) const noexcept {
-	if (auto it = m_impl->sounds.find(id); it != m_impl->sounds.end()) { return it->second; }
+	if (auto const* ret = m_impl->sounds.find(id)) { return *ret; }
 	return Sound::blank;
 }
 
 Source const& Instance::find_source(UID id) const noexcept {
-	if (auto it = m_impl->sources.find(id); it != m_impl->sources.end()) { return it->second; }
+	if (auto const* ret = m_impl->sources.find(id)) { return *ret; }
 	return Source::blank;
 }
 
 bool Instance::bind(Sound const& sound, Source const& source) {
-	if (valid() && source.valid() && sound.valid()) {
+	if (valid() && source.valid() && sound.valid() && m_impl->sounds.find(sound.m_id) && m_impl->sources.find(source.m_id)) {
 		if (any_in(source.state(), State::ePlaying, State::ePaused)) { detail::stop_source(source.m_handle); }
 		if (detail::set_source_prop(source.m_handle, AL_BUFFER, static_cast<ALint>(sound.m_buffer))) {
 			m_impl->bindings.bind(sound, source);
@@ -151,7 +225,7 @@ bool Instance::bind(Sound const& sound, Source const& source) {
 }
 
 bool Instance::unbind(Source const& source) {
-	if (valid() && source.valid()) {
+	if (valid() && source.valid() && m_impl->sources.find(source.m_id)) {
 		if (any_in(source.state(), State::ePlaying, State::ePaused)) { detail::stop_source(source.m_handle); }
 		if (detail::set_source_prop(source.m_handle, AL_BUFFER, 0)) {
 			m_impl->bindings.unbind(source);
@@ -162,14 +236,7 @@ bool Instance::unbind(Source const& source) {
 }
 
 Sound const& Instance::bound(Source const& source) const noexcept {
-	if (valid()) {
-		for (auto const& [buf, set] : m_impl->bindings.map) {
-			if (set.contains(source.m_handle)) {
-				auto it = m_impl->sounds.find(buf);
-				return it == m_impl->sounds.end() ? Sound::blank : it->second;
-			}
-		}
-	}
+	if (valid()) { return find_sound(m_impl->bindings.bound(source)); }
 	return Sound::blank;
 }
 
@@ -183,4 +250,7 @@ Result<Device> Instance::device() const {
 	if (valid()) { return Device(detail::device_name(m_impl->device)); }
 	return Error::eInvalidValue;
 }
+
+SampleRate Instance::sample_rate() const { return valid() ? detail::device_rate(m_impl->device) : 0; }
+std::size_t Instance::stream_count() const { return detail::StreamScheduler::instance().stream_count(); }
 } // namespace capo
@@ -0,0 +1,130 @@
+#include <capo/loader.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace capo {
+namespace {
+struct Job {
+	Loader::Request request;
+	std::promise<Result<PCM>> promise;
+	std::shared_ptr<std::atomic_bool> cancel;
+	std::shared_ptr<Loader::OnLoaded> on_loaded;
+	std::size_t index;
+	std::uint64_t sequence;
+
+	// max-heap order: highest priority, then earliest submission
+	friend bool operator<(Job const& lhs, Job const& rhs) noexcept {
+		if (lhs.request.priority != rhs.request.priority) { return lhs.request.priority < rhs.request.priority; }
+		return lhs.sequence > rhs.sequence;
+	}
+
+	Result<PCM> decode() const {
+		if (auto const* path = std::get_if<std::string>(&request.source)) { return PCM::from_file(path->c_str(), request.format, request.decode); }
+		return PCM::from_memory(std::get<std::span<std::byte const>>(request.source), request.format, request.decode);
+	}
+
+	void operator()() {
+		try {
+			auto result = cancel->load() ? Result<PCM>(Error::eCancelled) : decode();
+			if (*on_loaded) { (*on_loaded)(index, result); }
+			promise.set_value(std::move(result));
+		} catch (...) {
+			// eg bad_alloc sizing storage for a large asset: rethrown by the future's get() instead of terminating the worker
+			promise.set_exception(std::current_exception());
+		}
+	}
+};
+} // namespace
+
+struct Loader::Impl {
+	std::vector<Job> queue{}; // binary heap
+	std::mutex mutex{};
+	std::condition_variable cv{};
+	std::uint64_t next_sequence{};
+	bool stop{};
+	std::vector<std::jthread> workers{};
+
+	Impl(std::size_t threads) {
+		workers.reserve(threads);
+		for (std::size_t i = 0; i < threads; ++i) {
+			workers.emplace_back([this] {
+				while (auto job = pop()) { (*job)(); }
+			});
+		}
+	}
+
+	~Impl() {
+		{
+			auto lock = std::unique_lock(mutex);
+			stop = true;
+			// fulfil every pending promise so no waiter blocks forever
+			for (auto& job : queue) { job.cancel->store(true); }
+		}
+		cv.notify_all();
+		// workers drain the (now cancelled) queue and exit
+		for (auto& worker : workers) { worker.join(); }
+	}
+
+	void push(std::span<Job> jobs) {
+		{
+			auto lock = std::unique_lock(mutex);
+			for (auto& job : jobs) {
+				job.sequence = next_sequence++;
+				queue.push_back(std::move(job));
+				std::push_heap(queue.begin(), queue.end());
+			}
+		}
+		cv.notify_all();
+	}
+
+	std::optional<Job> pop() {
+		auto lock = std::unique_lock(mutex);
+		cv.wait(lock, [this] { return stop || !queue.empty(); });
+		if (queue.empty()) { return {}; }
+		std::pop_heap(queue.begin(), queue.end());
+		auto ret = std::move(queue.back());
+		queue.pop_back();
+		return ret;
+	}
+};
+
+// all SMFs need to be defined out-of-line for unique_ptr<incomplete_type> to compile
+Loader::Loader(std::size_t threads) : m_impl(ktl::make_unique<Impl>(threads > 0 ? threads : std::max(std::thread::hardware_concurrency(), 1U))) {}
+Loader::Loader(Loader&&) noexcept = default;
+Loader& Loader::operator=(Loader&&) noexcept = default;
+Loader::~Loader() = default;
+
+Loader::Batch Loader::load(std::span<Request const> requests, OnLoaded on_loaded) {
+	Batch ret;
+	ret.m_cancel = std::make_shared<std::atomic_bool>(false);
+	auto callback = std::make_shared<OnLoaded>(std::move(on_loaded));
+	std::vector<Job> jobs;
+	jobs.reserve(requests.size());
+	ret.futures.reserve(requests.size());
+	for (std::size_t index = 0; index < requests.size(); ++index) {
+		auto job = Job{requests[index], {}, ret.m_cancel, callback, index, {}};
+		ret.futures.push_back(job.promise.get_future());
+		jobs.push_back(std::move(job));
+	}
+	m_impl->push(jobs);
+	return ret;
+}
+
+std::future<Result<PCM>> Loader::load(Request request) {
+	auto batch = load(std::span(&request, 1));
+	return std::move(batch.futures.front());
+}
+
+std::size_t Loader::threads() const noexcept { return m_impl->workers.size(); }
+
+std::size_t Loader::pending() const {
+	auto lock = std::unique_lock(m_impl->mutex);
+	return m_impl->queue.size();
+}
+} // namespace capo
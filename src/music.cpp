@@ -6,15 +6,15 @@ namespace capo {
 using Clock = std::chrono::steady_clock;
 
 struct Music::Impl {
-	detail::StreamSource<> stream{};
+	detail::StreamSource stream{};
 
 	bool play() { return stream.ready() && stream.play(); }
-	bool pause() { return stream.ready() && detail::pause_source(stream.source()); }
+	bool pause() { return stream.ready() && stream.pause(); }
 	bool stop() { return stream.ready() && stream.stop(); }
 
 	bool gain(float value) const { return detail::set_source_prop(stream.source(), AL_GAIN, value); }
 	float gain() const { return detail::get_source_prop<ALfloat>(stream.source(), AL_GAIN); }
-	bool pitch(ALfloat value) const { return detail::set_source_prop(stream.source(), AL_PITCH, value); }
+	bool pitch(ALfloat value) { return stream.pitch(value); }
 	float pitch() const { return detail::get_source_prop<ALfloat>(stream.source(), AL_PITCH); }
 };
 
@@ -25,7 +25,7 @@ Music& Music::operator=(Music&&) noexcept = default;
 Music::Music(ktl::not_null<Instance*> instance) : Music() { m_instance = instance; }
 Music::~Music() = default;
 
-bool Music::valid() const noexcept { return m_instance && m_instance->valid(); }
+bool Music::valid() const noexcept { return m_impl && m_instance && m_instance->valid(); }
 bool Music::ready() const { return valid() && m_impl->stream.ready(); }
 
 Result<void> Music::open(char const* path) {
@@ -36,14 +36,98 @@ Result<void> Music::open(char const* path) {
 	return Error::eInvalidValue;
 }
 
-Result<void> Music::preload(PCM pcm) {
+Result<void> Music::open(std::span<std::byte const> bytes, FileFormat format) {
 	if (valid()) {
+		if (m_impl->stream.open(bytes, format)) { return Result<void>::success(); }
+		return Error::eInvalidData;
+	}
+	return Error::eInvalidValue;
+}
+
+Result<void> Music::open(Reader& reader, FileFormat format) {
+	if (valid()) {
+		if (m_impl->stream.open(reader, format)) { return Result<void>::success(); }
+		return Error::eInvalidData;
+	}
+	return Error::eInvalidValue;
+}
+
+Result<void> Music::preload(PCM pcm) { return preload(std::make_shared<PCM const>(std::move(pcm))); }
+
+Result<void> Music::preload(std::shared_ptr<PCM const> pcm) {
+	if (valid() && pcm) {
 		m_impl->stream.load(std::move(pcm));
 		return Result<void>::success();
 	}
 	return Error::eInvalidValue;
 }
 
+Result<void> Music::enqueue(char const* path) {
+	if (valid()) {
+		if (m_impl->stream.enqueue(path)) { return Result<void>::success(); }
+		return Error::eIOError;
+	}
+	return Error::eInvalidValue;
+}
+
+Result<void> Music::enqueue(std::span<std::byte const> bytes, FileFormat format) {
+	if (valid()) {
+		if (m_impl->stream.enqueue(bytes, format)) { return Result<void>::success(); }
+		return Error::eInvalidData;
+	}
+	return Error::eInvalidValue;
+}
+
+Result<void> Music::enqueue(Reader& reader, FileFormat format) {
+	if (valid()) {
+		if (m_impl->stream.enqueue(reader, format)) { return Result<void>::success(); }
+		return Error::eInvalidData;
+	}
+	return Error::eInvalidValue;
+}
+
+Result<void> Music::enqueue(std::shared_ptr<PCM const> pcm) {
+	if (valid() && pcm) {
+		if (m_impl->stream.enqueue(std::move(pcm))) { return Result<void>::success(); }
+		return Error::eInvalidData;
+	}
+	return Error::eInvalidValue;
+}
+
+std::size_t Music::queued() const { return valid() ? m_impl->stream.queued() : 0; }
+
+Result<void> Music::crossfade(Time duration, char const* path) {
+	if (valid()) {
+		if (m_impl->stream.crossfade(duration, path)) { return Result<void>::success(); }
+		return Error::eIOError;
+	}
+	return Error::eInvalidValue;
+}
+
+Result<void> Music::crossfade(Time duration, std::span<std::byte const> bytes, FileFormat format) {
+	if (valid()) {
+		if (m_impl->stream.crossfade(duration, bytes, format)) { return Result<void>::success(); }
+		return Error::eInvalidData;
+	}
+	return Error::eInvalidValue;
+}
+
+Result<void> Music::crossfade(Time duration, Reader& reader, FileFormat format) {
+	if (valid()) {
+		if (m_impl->stream.crossfade(duration, reader, format)) { return Result<void>::success(); }
+		return Error::eInvalidData;
+	}
+	return Error::eInvalidValue;
+}
+
+Result<void> Music::crossfade(Time duration, std::shared_ptr<PCM const> pcm) {
+	if (valid() && pcm) {
+		if (m_impl->stream.crossfade(duration, std::move(pcm))) { return Result<void>::success(); }
+		return Error::eInvalidData;
+	}
+	return Error::eInvalidValue;
+}
+
 bool Music::play() { return valid() && m_impl->play(); }
 bool Music::pause() { return valid() && m_impl->pause(); }
 bool Music::stop() { return valid() && m_impl->stop(); }
@@ -53,16 +137,15 @@ bool Music::pitch(float value) { return valid() && m_impl->pitch(value); }
 float Music::pitch() const { return valid() ? m_impl->pitch() : 0.0f; }
 bool Music::loop(bool value) { return valid() ? (m_impl->stream.loop(value), true) : false; }
 bool Music::looping() const { return valid() && m_impl->stream.looping(); }
+bool Music::buffering(Buffering const& value) { return valid() ? (m_impl->stream.buffering(value), true) : false; }
+Music::Buffering Music::buffering() const { return valid() ? m_impl->stream.buffering() : Buffering{}; }
 Result<void> Music::seek(Time stamp) { return ready() && m_impl->stream.seek(stamp) ? Result<void>::success() : Error::eInvalidValue; }
-Time Music::position() const { return m_impl->stream.position(); }
+Time Music::position() const { return valid() ? m_impl->stream.position() : Time(); }
 
-Metadata const& Music::meta() const {
-	if (valid()) { return m_impl->stream.streamer().meta(); }
-	static Metadata const fallback{};
-	return fallback;
-}
+Metadata Music::meta() const { return valid() ? m_impl->stream.meta() : Metadata{}; }
 
-utils::Size Music::size() const { return valid() ? m_impl->stream.streamer().size() : utils::Size(); }
-utils::Rate Music::sample_rate() const { return valid() ? m_impl->stream.streamer().rate() : utils::Rate(); }
-State Music::state() const { return valid() ? detail::source_state(m_impl->stream.source()) : State::eUnknown; }
+utils::Size Music::size() const { return valid() ? m_impl->stream.size() : utils::Size(); }
+utils::Rate Music::sample_rate() const { return valid() ? m_impl->stream.meta().sample_rate() : utils::Rate(); }
+State Music::state() const { return valid() ? m_impl->stream.state() : State::eUnknown; }
+Music::Stats Music::stats() const { return valid() ? m_impl->stream.stats() : Stats{}; }
 } // namespace capo
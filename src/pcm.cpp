@@ -6,13 +6,25 @@
 #include <capo/pcm.hpp>
 #include <capo/types.hpp>
 #include <impl_al.hpp>
+#include <impl_convert.hpp>
+#include <impl_file.hpp>
+#include <impl_format.hpp>
+#include <impl_resample.hpp>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <unordered_map>
 
 namespace capo {
 namespace {
@@ -22,12 +34,82 @@ std::size_t pcm_frame_count(T& t) noexcept {
 }
 std::size_t pcm_frame_count(drmp3& t) noexcept { return drmp3_get_pcm_frame_count(&t); }
 
-template <typename FinitFromMemory, typename FinitFromFile, typename Funinit, typename Fread, typename Fseek>
+// MP3 length from its headers (Xing / VBRI / constant bitrate): avoids decoding the whole file on open
+std::optional<std::size_t> mp3_frame_hint(std::span<std::byte const> bytes) noexcept { return detail::mp3_frame_count(bytes, true); }
+
+std::optional<std::size_t> mp3_frame_hint(char const* path) noexcept {
+	// only the leading bytes of the mapping are touched, unless there is no VBR header (file size is used)
+	auto const map = detail::FileMap(path);
+	return detail::mp3_frame_count(map.bytes(), true);
+}
+
+std::optional<std::size_t> mp3_frame_hint(Reader& reader) noexcept {
+	// reader is at the start of data: skip any ID3v2 tag, read the first frame, and rewind
+	std::array<std::byte, 4096> head{};
+	auto offset = reader.read(std::span(head).first(10)) == 10 ? detail::id3_size(head) : std::size_t{};
+	auto const size = reader.seek(offset) ? reader.read(head) : std::size_t{};
+	auto const ret = detail::mp3_frame_count(std::span(head).first(size), false);
+	return reader.seek(0) ? ret : std::nullopt;
+}
+
+using Mp3SeekTable = std::shared_ptr<std::vector<drmp3_seek_point>>;
+
+// calculating seek points scans every frame header in the file: roughly one point per second of audio
+Mp3SeekTable calculate_seek_table(drmp3& mp3, Metadata const& meta) {
+	auto const seconds = meta.total_frame_count / std::max(meta.rate, SampleRate{1});
+	auto count = static_cast<drmp3_uint32>(std::clamp(seconds, std::size_t(16), std::size_t(4096)));
+	auto ret = std::make_shared<std::vector<drmp3_seek_point>>(count);
+	if (!drmp3_calculate_seek_points(&mp3, &count, ret->data())) { return {}; }
+	ret->resize(count);
+	return ret;
+}
+
+// seek tables of MP3 files by path: reused by subsequent opens while the file's size and modification time are unchanged
+Mp3SeekTable cached_seek_table(std::string const& path, drmp3& mp3, Metadata const& meta) {
+	struct Entry {
+		std::uintmax_t size{};
+		std::filesystem::file_time_type modified{};
+		Mp3SeekTable table{};
+	};
+	static constexpr std::size_t max_entries_v = 256;
+	static auto mutex = std::mutex{};
+	static auto entries = std::unordered_map<std::string, Entry>{};
+
+	auto ec = std::error_code{};
+	auto const size = std::filesystem::file_size(path, ec);
+	auto const modified = std::filesystem::last_write_time(path, ec);
+	if (ec) { return calculate_seek_table(mp3, meta); }
+	{
+		auto lock = std::scoped_lock(mutex);
+		if (auto const it = entries.find(path); it != entries.end() && it->second.size == size && it->second.modified == modified) { return it->second.table; }
+	}
+	auto ret = calculate_seek_table(mp3, meta);
+	if (!ret) { return ret; }
+	auto lock = std::scoped_lock(mutex);
+	if (entries.size() >= max_entries_v && !entries.contains(path)) { entries.erase(entries.begin()); }
+	entries.insert_or_assign(path, Entry{size, modified, ret});
+	return ret;
+}
+
+// Reader adapters for decoders' callback init functions
+std::size_t reader_read(void* reader, void* out, std::size_t size) noexcept { return static_cast<Reader*>(reader)->read({static_cast<std::byte*>(out), size}); }
+
+template <typename Bool, typename Origin, Origin start_v>
+Bool reader_seek(void* reader, int offset, Origin origin) noexcept {
+	auto& r = *static_cast<Reader*>(reader);
+	auto const base = origin == start_v ? std::int64_t{} : static_cast<std::int64_t>(r.tell());
+	auto const target = base + offset;
+	return target >= 0 && r.seek(static_cast<std::size_t>(target)) ? 1 : 0;
+}
+
+template <typename FinitFromMemory, typename FinitFromFile, typename FinitFromReader, typename Funinit, typename Fread, typename FreadF32, typename Fseek>
 struct TFacade {
 	FinitFromMemory const initFromMemory;
 	FinitFromFile const initFromFile;
+	FinitFromReader const initFromReader;
 	Funinit const uninit;
 	Fread const read;
+	FreadF32 const readF32;
 	Fseek const seek;
 };
 
@@ -37,11 +119,17 @@ TFacade(T...) -> TFacade<T...>;
 template <typename TFormat>
 constexpr auto make_facade() noexcept {
 	if constexpr (std::is_same_v<TFormat, drwav>) {
-		return TFacade{&drwav_init_memory, &drwav_init_file, &drwav_uninit, &drwav_read_pcm_frames_s16, &drwav_seek_to_pcm_frame};
+		auto const init = [](Reader& reader) { return drwav_init(&reader_read, &reader_seek<drwav_bool32, drwav_seek_origin, drwav_seek_origin_start>, &reader, nullptr); };
+		return TFacade{&drwav_init_memory, &drwav_init_file, +init, &drwav_uninit, &drwav_read_pcm_frames_s16, &drwav_read_pcm_frames_f32,
+					  &drwav_seek_to_pcm_frame};
 	} else if constexpr (std::is_same_v<TFormat, drmp3>) {
-		return TFacade{&drmp3_init_memory, &drmp3_init_file, &drmp3_uninit, &drmp3_read_pcm_frames_s16, &drmp3_seek_to_pcm_frame};
+		auto const init = [](Reader& reader) { return drmp3_init(&reader_read, &reader_seek<drmp3_bool32, drmp3_seek_origin, drmp3_seek_origin_start>, &reader, nullptr); };
+		return TFacade{&drmp3_init_memory, &drmp3_init_file, +init, &drmp3_uninit, &drmp3_read_pcm_frames_s16, &drmp3_read_pcm_frames_f32,
+					  &drmp3_seek_to_pcm_frame};
 	} else if constexpr (std::is_same_v<TFormat, drflac>) {
-		return TFacade{&drflac_open_memory, &drflac_open_file, &drflac_close, &drflac_read_pcm_frames_s16, &drflac_seek_to_pcm_frame};
+		auto const init = [](Reader& reader) { return drflac_open(&reader_read, &reader_seek<drflac_bool32, drflac_seek_origin, drflac_seek_origin_start>, &reader, nullptr); };
+		return TFacade{&drflac_open_memory, &drflac_open_file, +init, &drflac_close, &drflac_read_pcm_frames_s16, &drflac_read_pcm_frames_f32,
+					  &drflac_seek_to_pcm_frame};
 	} else {
 		static_assert(detail::always_false_v<TFormat>, "Invalid TFormat");
 	}
@@ -50,11 +138,16 @@ constexpr auto make_facade() noexcept {
 template <typename TFormat>
 class DrFormat {
   public:
+	static constexpr bool mp3_v = std::is_same_v<TFormat, drmp3>;
+
 	std::optional<Error> m_error{};
 	Metadata m_meta{};
 	std::size_t m_channels{};
+	// m_meta.total_frame_count is an estimate (MP3 headers): the decoder determines the actual end of data
+	bool m_estimated{};
 
 	DrFormat(std::span<std::byte const> bytes) noexcept {
+		if constexpr (mp3_v) { m_hint = mp3_frame_hint(bytes); }
 		if (m_format = facade().initFromMemory(bytes.data(), bytes.size(), nullptr); m_format) {
 			set_meta_from_audio();
 		} else {
@@ -63,6 +156,10 @@ class DrFormat {
 	}
 
 	DrFormat(char const* path) noexcept {
+		if constexpr (mp3_v) {
+			m_hint = mp3_frame_hint(path);
+			m_path = path;
+		}
 		if (m_format = facade().initFromFile(path, nullptr); m_format) {
 			set_meta_from_audio();
 		} else {
@@ -70,29 +167,67 @@ class DrFormat {
 		}
 	}
 
+	DrFormat(Reader& reader) noexcept {
+		if constexpr (mp3_v) { m_hint = mp3_frame_hint(reader); }
+		if (m_format = facade().initFromReader(reader); m_format) {
+			set_meta_from_audio();
+		} else {
+			m_error = Error::eInvalidData;
+		}
+	}
+
 	~DrFormat() noexcept {
 		if (!m_error) { facade().uninit(m_format); }
 	}
 
 	std::size_t read(std::span<PCM::Sample> out, std::size_t count) noexcept { return facade().read(m_format, static_cast<std::uint64_t>(count), out.data()); }
-	std::size_t read(std::span<PCM::Sample> out) noexcept { return read(out, m_meta.total_frame_count); }
-	bool seek(std::size_t frameIndex) noexcept { return facade().seek(m_format, static_cast<std::uint64_t>(frameIndex)); }
+	std::size_t read(std::span<PCM::SampleF32> out, std::size_t count) noexcept {
+		return facade().readF32(m_format, static_cast<std::uint64_t>(count), out.data());
+	}
+	template <typename T>
+	std::size_t read(std::span<T> out) noexcept {
+		return read(out, m_meta.total_frame_count);
+	}
+	bool seek(std::size_t frameIndex) noexcept {
+		// drmp3 seeks by decoding from the start unless bound to a seek table: built on the first seek (not on open)
+		if constexpr (mp3_v) {
+			if (frameIndex > 0) { bind_seek_table(); }
+		}
+		return facade().seek(m_format, static_cast<std::uint64_t>(frameIndex));
+	}
 
   private:
 	TFormat* m_format;
+	// MP3 only
+	std::optional<std::size_t> m_hint{};
+	std::string m_path{};
+	Mp3SeekTable m_seek_table{};
+	bool m_seek_bound{};
 
 	static auto const& facade() noexcept {
 		static constexpr auto f = make_facade<TFormat>();
 		return f;
 	}
 
+	void bind_seek_table() noexcept {
+		if (m_seek_bound) { return; }
+		m_seek_bound = true;
+		m_seek_table = m_path.empty() ? calculate_seek_table(*m_format, m_meta) : cached_seek_table(m_path, *m_format, m_meta);
+		if (m_seek_table && !m_seek_table->empty()) {
+			drmp3_bind_seek_table(m_format, static_cast<drmp3_uint32>(m_seek_table->size()), m_seek_table->data());
+		}
+	}
+
 	void set_meta_from_audio() noexcept {
-		auto const frameCount = pcm_frame_count(*m_format);
+		// a header frame count of 0 is unusable (streams would end immediately): count frames instead
+		if (m_hint == std::size_t{}) { m_hint.reset(); }
+		m_estimated = m_hint.has_value();
+		auto const frameCount = m_hint ? *m_hint : pcm_frame_count(*m_format);
 		auto const channels = static_cast<std::size_t>(m_format->channels);
 		auto const rate = static_cast<std::size_t>(m_format->sampleRate);
 		m_meta = {
 			.rate = rate,
-			.format = channels == 2 ? SampleFormat::eStereo16 : SampleFormat::eMono16,
+			.format = Metadata::make_format(channels, SampleType::eS16),
 			.total_frame_count = frameCount,
 		};
 		m_channels = channels;
@@ -103,24 +238,212 @@ using WAV = DrFormat<drwav>;
 using FLAC = DrFormat<drflac>;
 using MP3 = DrFormat<drmp3>;
 
+// drmp3 seeks by decoding from the start: splitting an MP3 would decode its head once per chunk
 template <typename TFormat>
-Result<PCM> obtain_pcm(std::span<std::byte const> bytes) {
-	TFormat f(bytes); // can't use Result pattern here because an initialized drwav object contains and uses a pointer to its own address
+constexpr bool parallel_decode_v = !std::is_same_v<TFormat, MP3>;
+
+// below this many frames per thread, spawning / seeking costs more than it saves (~6s at 44.1kHz)
+constexpr std::size_t min_parallel_frames_v = std::size_t(1) << 18;
+
+std::size_t decode_threads(DecodeInfo const& info, std::size_t frame_count) noexcept {
+	std::size_t const requested = info.threads > 0 ? info.threads : std::max(std::thread::hardware_concurrency(), 1U);
+	return std::clamp(frame_count / min_parallel_frames_v, std::size_t(1), requested);
+}
+
+// each chunk is decoded by its own TFormat (seeked to its first frame) straight into its slice of out
+template <typename TFormat, typename T>
+bool read_chunks(std::span<std::byte const> bytes, std::span<T> out, Metadata const& meta, std::size_t threads) {
+	auto const channels = Metadata::channel_count(meta.format);
+	auto const chunk = (meta.total_frame_count + threads - 1) / threads;
+	std::atomic_bool ret = true;
+	auto decode = [&](std::size_t const first) {
+		auto const count = std::min(chunk, meta.total_frame_count - first);
+		TFormat f(bytes);
+		if (f.m_error || !f.seek(first) || f.read(out.subspan(first * channels, count * channels), count) < count) { ret = false; }
+	};
+	{
+		std::vector<std::jthread> workers;
+		workers.reserve(threads - 1);
+		for (std::size_t first = chunk; first < meta.total_frame_count; first += chunk) { workers.emplace_back(decode, first); }
+		decode(0); // first chunk on this thread
+	} // join all workers
+	return ret;
+}
+
+// source: bytes / Reader (only bytes can be decoded in parallel: a Reader has a single position)
+template <typename TFormat, typename T, typename Source>
+bool read_all(TFormat& f, Source& source, PCM::Storage<T>& out, DecodeInfo const& info) {
+	auto& meta = f.m_meta;
+	out.resize(meta.sample_count(meta.total_frame_count, f.m_channels));
+	if (f.m_estimated) {
+		// decode until the decoder runs dry, growing / trimming out to the actual length
+		constexpr std::size_t grow_v = 4096;
+		std::size_t frames = meta.total_frame_count > 0 ? f.read(std::span<T>(out), meta.total_frame_count) : 0;
+		// keep growing while the decoder fills all that was asked of it (also if the estimate is 0)
+		for (std::size_t read = frames, asked = meta.total_frame_count; read == asked;) {
+			out.resize(meta.sample_count(frames + grow_v, f.m_channels));
+			read = f.read(std::span<T>(out).subspan(meta.sample_count(frames, f.m_channels)), grow_v);
+			asked = grow_v;
+			frames += read;
+		}
+		out.resize(meta.sample_count(frames, f.m_channels));
+		meta.total_frame_count = frames;
+		return frames > 0;
+	}
+	if constexpr (std::is_same_v<Source, std::span<std::byte const>>) {
+		auto const threads = parallel_decode_v<TFormat> ? decode_threads(info, meta.total_frame_count) : 1;
+		if (threads > 1) { return read_chunks<TFormat>(source, std::span<T>(out), meta, threads); }
+	}
+	return f.read(std::span<T>(out)) >= meta.total_frame_count;
+}
+
+template <typename TFormat, typename Source>
+Result<PCM> obtain_pcm(Source& source, DecodeInfo const& info) {
+	TFormat f(source); // can't use Result pattern here because an initialized drwav object contains and uses a pointer to its own address
 	if (f.m_error) {
 		return *f.m_error;
 	} else if (!Metadata::supported(f.m_channels) || f.m_meta.rate == 0) {
 		return Error::eUnsupportedMetadata;
 	} else {
-		PCM ret;
-		ret.meta = f.m_meta;
-		ret.samples.resize(ret.meta.sample_count(f.m_meta.total_frame_count, Metadata::channel_count(f.m_meta.format)));
-		auto const read = f.read(ret.samples);
-		if (read < f.m_meta.total_frame_count) { return Error::eUnexpectedEOF; }
-		ret.bytes = ret.samples.size() * sizeof(PCM::Sample);
+		// storage must be constructed (not assigned) with the allocator for it to stick
+		PCM ret{
+			.meta = f.m_meta,
+			.samples = PCM::Storage<PCM::Sample>(info.resource),
+			.samples_f32 = PCM::Storage<PCM::SampleF32>(info.resource),
+		};
+		ret.meta.format = Metadata::make_format(f.m_channels, info.type);
+		bool const complete = info.type == SampleType::eF32 ? read_all(f, source, ret.samples_f32, info) : read_all(f, source, ret.samples, info);
+		if (!complete) { return Error::eUnexpectedEOF; }
+		ret.meta.total_frame_count = f.m_meta.total_frame_count;
+		ret.bytes = ret.data().size();
+		return ret;
+	}
+}
+
+// samples are copied (converted if necessary) out of bytes: no decoding
+Result<PCM> obtain_capo(std::span<std::byte const> bytes, DecodeInfo const& info) {
+	auto const raw = detail::parse_capo(bytes);
+	if (!raw) { return Error::eInvalidData; }
+	auto const channels = Metadata::channel_count(raw->meta.format);
+	PCM ret{
+		.meta = raw->meta,
+		.samples = PCM::Storage<PCM::Sample>(info.resource),
+		.samples_f32 = PCM::Storage<PCM::SampleF32>(info.resource),
+	};
+	ret.meta.format = Metadata::make_format(channels, info.type);
+	auto copy = [&raw](auto& out) {
+		out.resize(Metadata::sample_count(raw->meta.total_frame_count, Metadata::channel_count(raw->meta.format)));
+		if (Metadata::sample_type(raw->meta.format) == SampleType::eF32) {
+			detail::convert_samples(raw->samples<PCM::SampleF32>(), std::span(out));
+		} else {
+			detail::convert_samples(raw->samples<PCM::Sample>(), std::span(out));
+		}
+	};
+	if (info.type == SampleType::eF32) {
+		copy(ret.samples_f32);
+	} else {
+		copy(ret.samples);
+	}
+	ret.bytes = ret.data().size();
+	return ret;
+}
+
+// reads (up to out.size()) samples stored as From out of reader, converting into out; returns number of samples read
+template <typename From, typename To>
+std::size_t read_samples(Reader& reader, std::span<To> out) noexcept {
+	if constexpr (std::is_same_v<From, To>) {
+		return reader.read(std::as_writable_bytes(out)) / sizeof(To);
+	} else {
+		From chunk[1024];
+		std::size_t ret{};
+		while (ret < out.size()) {
+			auto const count = std::min(out.size() - ret, std::size(chunk));
+			auto const read = reader.read(std::as_writable_bytes(std::span(chunk, count))) / sizeof(From);
+			detail::convert_samples(std::span<From const>(chunk, read), out.subspan(ret));
+			ret += read;
+			if (read < count) { break; }
+		}
 		return ret;
 	}
 }
 
+template <typename To>
+std::size_t read_samples(Reader& reader, SampleFormat stored, std::span<To> out) noexcept {
+	if (Metadata::sample_type(stored) == SampleType::eF32) { return read_samples<PCM::SampleF32>(reader, out); }
+	return read_samples<PCM::Sample>(reader, out);
+}
+
+// samples are read (converted if necessary) out of reader: no decoding
+Result<PCM> obtain_capo(Reader& reader, DecodeInfo const& info) {
+	auto header = detail::CapoHeader{};
+	auto const meta = reader.read(header) == header.size() ? detail::parse_capo_header(header) : std::nullopt;
+	if (!meta) { return Error::eInvalidData; }
+	auto const channels = Metadata::channel_count(meta->format);
+	PCM ret{
+		.meta = *meta,
+		.samples = PCM::Storage<PCM::Sample>(info.resource),
+		.samples_f32 = PCM::Storage<PCM::SampleF32>(info.resource),
+	};
+	ret.meta.format = Metadata::make_format(channels, info.type);
+	auto read = [&](auto& out) {
+		out.resize(Metadata::sample_count(meta->total_frame_count, channels));
+		// clamp to what is actually present (truncated data)
+		out.resize(read_samples(reader, meta->format, std::span(out)) / channels * channels);
+		ret.meta.total_frame_count = out.size() / channels;
+	};
+	if (info.type == SampleType::eF32) {
+		read(ret.samples_f32);
+	} else {
+		read(ret.samples);
+	}
+	ret.bytes = ret.data().size();
+	return ret;
+}
+
+// identify format from the leading bytes of reader (if unknown), leaving it rewound to the start
+Result<FileFormat> rewind(Reader& reader, FileFormat format) noexcept {
+	if (!reader.seek(0)) { return Error::eIOError; }
+	if (format != FileFormat::eUnknown) { return format; }
+	std::byte head[4096];
+	auto const read = reader.read(head);
+	if (!reader.seek(0)) { return Error::eIOError; }
+	return detail::probe_format(std::span(head, read));
+}
+
+// runs in through resampler (in chunks, converting to / from float as necessary) into out
+template <typename T>
+void resample_samples(detail::Resampler& resampler, std::span<T const> in, PCM::Storage<T>& out) {
+	if (!resampler.active()) {
+		out.assign(in.begin(), in.end());
+		return;
+	}
+	constexpr std::size_t chunk_v = 4096;
+	auto const channels = resampler.channels();
+	out.resize(Metadata::sample_count(resampler.output_frames(in.size() / channels), channels));
+	std::vector<float> buffer(chunk_v);
+	std::size_t written{};
+	auto drain = [&] {
+		if constexpr (std::is_same_v<T, float>) {
+			written += resampler.pull(std::span<float>(out).subspan(written));
+		} else {
+			while (auto const pulled = resampler.pull(buffer)) {
+				detail::convert_samples(std::span<float const>(buffer).first(pulled), std::span<T>(out).subspan(written));
+				written += pulled;
+			}
+		}
+	};
+	for (std::size_t i = 0; i < in.size();) {
+		auto const count = std::min(chunk_v / channels * channels, in.size() - i);
+		detail::convert_samples(in.subspan(i, count), std::span(buffer));
+		resampler.push(std::span<float const>(buffer).first(count));
+		drain();
+		i += count;
+	}
+	resampler.flush();
+	drain();
+	out.resize(written);
+}
+
 struct ExtFileFormat {
 	std::string_view ext;
 	FileFormat format;
@@ -130,7 +453,8 @@ struct ExtFileFormat {
 static constexpr ExtFileFormat supported_formats[] = {
 	{".wav", FileFormat::eWav},
 	{".flac", FileFormat::eFlac},
-	{".mp3", FileFormat::eMp3}
+	{".mp3", FileFormat::eMp3},
+	{".capo", FileFormat::eCapo}
 };
 /* clang-format on */
 
@@ -154,34 +478,88 @@ std::vector<std::byte> file_bytes(char const* path) {
 	return {};
 }
 
-constexpr FileFormat operator+(FileFormat const a, int const b) { return static_cast<FileFormat>(static_cast<int>(a) + b); }
+// signature takes precedence over extension: files may be missing one or have the wrong one
+FileFormat resolve_format(std::span<std::byte const> bytes, char const* path) noexcept {
+	if (auto const ret = detail::probe_format(bytes); ret != FileFormat::eUnknown) { return ret; }
+	return path ? format_from_filename(path) : FileFormat::eUnknown;
+}
+
+// source: bytes / Reader; resampled to info.rate if requested
+template <typename Source>
+Result<PCM> decode(Source& source, FileFormat const format, DecodeInfo const& info) {
+	auto ret = [&]() -> Result<PCM> {
+		static_assert(static_cast<int>(FileFormat::eCOUNT_) == 5, "Unhandled file format");
+		switch (format) {
+		case FileFormat::eWav: return obtain_pcm<WAV>(source, info);
+		case FileFormat::eFlac: return obtain_pcm<FLAC>(source, info);
+		case FileFormat::eMp3: return obtain_pcm<MP3>(source, info);
+		case FileFormat::eCapo: return obtain_capo(source, info);
+		default: return Error::eUnknownFormat;
+		}
+	}();
+	if (!ret || info.rate == 0 || ret->meta.rate == info.rate) { return ret; }
+	return ret->resample(info.rate);
+}
 } // namespace
 
-Result<PCM> PCM::from_file(char const* path, FileFormat format) {
-	if (format == FileFormat::eUnknown) { format = format_from_filename(path); }
-	return PCM::from_memory(file_bytes(path), format);
+Result<PCM> PCM::from_file(char const* path, FileFormat format, DecodeInfo const& info) {
+	// decode straight out of a read-only mapping (unmapped on return), avoiding a copy of the compressed bytes
+	if (auto const map = detail::FileMap(path)) {
+		if (format == FileFormat::eUnknown) { format = resolve_format(map.bytes(), path); }
+		return PCM::from_memory(map.bytes(), format, info);
+	}
+	auto const bytes = file_bytes(path);
+	if (format == FileFormat::eUnknown) { format = resolve_format(bytes, path); }
+	return PCM::from_memory(bytes, format, info);
 }
 
-Result<PCM> PCM::from_memory(std::span<std::byte const> bytes, FileFormat format) {
+Result<PCM> PCM::from_memory(std::span<std::byte const> bytes, FileFormat format, DecodeInfo const& info) {
 	if (bytes.empty()) { return Error::eIOError; }
+	// if format is not specified, identify it from its signature: only one decoder is ever attempted
+	if (format == FileFormat::eUnknown) { format = detail::probe_format(bytes); }
 
-	static_assert(static_cast<int>(FileFormat::eCOUNT_) == 4, "Unhandled file format");
-	auto try_load = [&](FileFormat const fmt) -> Result<PCM> {
-		switch (fmt) {
-		case FileFormat::eWav: return obtain_pcm<WAV>(bytes);
-		case FileFormat::eFlac: return obtain_pcm<FLAC>(bytes);
-		case FileFormat::eMp3: return obtain_pcm<MP3>(bytes);
-		default: return Error::eUnknownFormat;
-		}
-	};
+	return decode(bytes, format, info);
+}
 
-	// if format is specified, only attempt to load that
-	if (format != FileFormat::eUnknown) { return try_load(format); }
-	// otherwise attempt to load each supported format
-	for (format = FileFormat::eUnknown + 1; format < FileFormat::eCOUNT_; format = format + 1) {
-		if (auto pcm = try_load(format)) { return pcm; }
+Result<PCM> PCM::from_reader(Reader& reader, FileFormat format, DecodeInfo const& info) {
+	auto const rewound = rewind(reader, format);
+	if (!rewound) { return rewound.error(); }
+	return decode(reader, *rewound, info);
+}
+
+Result<PCM> PCM::resample(SampleRate rate) const {
+	if (rate == 0 || meta.rate == 0) { return Error::eInvalidValue; }
+	auto const channels = Metadata::channel_count(meta.format);
+	PCM ret{
+		.meta = meta,
+		.samples = Storage<Sample>(samples.get_allocator().resource()),
+		.samples_f32 = Storage<SampleF32>(samples_f32.get_allocator().resource()),
+	};
+	ret.meta.rate = rate;
+	auto resampler = detail::Resampler(meta.rate, rate, channels);
+	if (Metadata::sample_type(meta.format) == SampleType::eF32) {
+		resample_samples(resampler, std::span<SampleF32 const>(samples_f32), ret.samples_f32);
+	} else {
+		resample_samples(resampler, std::span<Sample const>(samples), ret.samples);
 	}
-	return Error::eUnknownFormat;
+	ret.meta.total_frame_count = ret.data().size() / Metadata::sample_size(meta.format) / channels;
+	ret.bytes = ret.data().size();
+	return ret;
+}
+
+Result<void> PCM::bake(char const* path) const {
+	if constexpr (std::endian::native != std::endian::little) { return Error::eUnsupportedMetadata; }
+	auto const channels = Metadata::channel_count(meta.format);
+	if (meta.rate == 0) { return Error::eUnsupportedMetadata; }
+	auto out_meta = meta;
+	out_meta.total_frame_count = data().size() / (channels * Metadata::sample_size(meta.format));
+	auto const header = detail::make_capo_header(out_meta);
+	auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+	if (!file) { return Error::eIOError; }
+	file.write(reinterpret_cast<char const*>(header.data()), static_cast<std::streamsize>(header.size()));
+	file.write(reinterpret_cast<char const*>(data().data()), static_cast<std::streamsize>(out_meta.total_frame_count * channels * Metadata::sample_size(meta.format)));
+	if (!file.flush()) { return Error::eIOError; }
+	return Result<void>::success();
 }
 
 struct PCM::Streamer::File {
@@ -196,38 +574,167 @@ struct PCM::Streamer::File {
 	} shared;
 	FileFormat format{};
 	std::size_t channels = 1;
+	// where samples come from (raw data may legitimately be empty)
+	enum class Kind { eNone, eRaw, eReader, eDecoder } kind{};
+	// 16-bit PCM WAV / capo: samples served straight out of the file mapping (or bytes), no decoder
+	detail::FileMap map;
+	detail::RawPCM raw;
+	// capo: samples pulled from a Reader, no decoder
+	Reader* reader{};
+	// inline sample rate conversion (source => resampled meta)
+	detail::Resampler resampler;
+	SampleRate target_rate{};
+	Metadata resampled;
+	std::vector<float> resample_in;
+	std::vector<float> resample_out;
+
+	void resample(SampleRate rate) {
+		target_rate = rate;
+		resampler = {};
+		if (rate == 0 || shared.meta.rate == 0 || shared.meta.rate == rate) { return; }
+		resampler = detail::Resampler(shared.meta.rate, rate, Metadata::channel_count(shared.meta.format));
+		resampled = shared.meta;
+		resampled.rate = rate;
+		resampled.total_frame_count = resampler.output_frames(shared.meta.total_frame_count);
+	}
 
-	Result<void> open(char const* path) noexcept {
-		auto const fmt = format_from_filename(path);
+	// discard the previously opened file / decoder
+	void reset() noexcept {
+		wav.reset();
+		mp3.reset();
+		flac.reset();
+		shared = {};
+		format = {};
+		kind = {};
+		map = {};
+		raw = {};
+		reader = {};
+	}
+
+	Result<void> open(char const* path, SampleType type) noexcept {
+		reset();
+		// only the leading bytes of the mapping are touched (paged in) to probe the format
+		map = detail::FileMap(path);
+		auto const fmt = resolve_format(map.bytes(), path);
+		if (auto const pcm = detail::parse_raw(map.bytes(), fmt)) { return open_raw(*pcm, fmt, type); }
+		map = {};
+		return open_decoder(path, fmt, type);
+	}
+
+	Result<void> open(std::span<std::byte const> bytes, FileFormat fmt, SampleType type) noexcept {
+		reset();
+		if (fmt == FileFormat::eUnknown) { fmt = detail::probe_format(bytes); }
+		if (auto const pcm = detail::parse_raw(bytes, fmt)) { return open_raw(*pcm, fmt, type); }
+		// decoders read compressed bytes in place, as required
+		return open_decoder(bytes, fmt, type);
+	}
+
+	Result<void> open(Reader& source, FileFormat fmt, SampleType type) noexcept {
+		reset();
+		auto const rewound = rewind(source, fmt);
+		if (!rewound) { return rewound.error(); }
+		if (*rewound == FileFormat::eCapo) { return open_reader(source, type); }
+		return open_decoder(source, *rewound, type);
+	}
+
+	// source: path / bytes / Reader
+	template <typename Source>
+	Result<void> open_decoder(Source& source, FileFormat const fmt, SampleType const type) noexcept {
 		auto loadInto = [&](auto& out) -> Result<void> {
-			out.emplace(path);
+			out.emplace(source);
 			if (out->m_error) { return *out->m_error; }
 			if (!Metadata::supported(out->m_channels) || out->m_meta.rate == 0) { return Error::eUnsupportedMetadata; }
 			shared.meta = out->m_meta;
+			shared.meta.format = Metadata::make_format(out->m_channels, type);
 			format = fmt;
+			kind = Kind::eDecoder;
 			channels = out->m_channels;
 			shared.remain = channels * std::size_t(out->m_meta.total_frame_count);
-			shared.bytes = shared.remain * sizeof(PCM::Sample);
+			shared.bytes = shared.remain * Metadata::sample_size(shared.meta.format);
 			return Result<void>::success();
 		};
 		switch (fmt) {
 		case FileFormat::eWav: return loadInto(wav);
 		case FileFormat::eMp3: return loadInto(mp3);
 		case FileFormat::eFlac: return loadInto(flac);
+		case FileFormat::eCapo: return Error::eInvalidData;
 		case FileFormat::eUnknown: return Error::eUnknownFormat;
 		case FileFormat::eCOUNT_: return Error::eInvalidValue;
 		}
 		return Error::eUnknown;
 	}
 
-	std::size_t read(std::span<PCM::Sample> out_samples) noexcept {
+	Result<void> open_raw(detail::RawPCM const& pcm, FileFormat fmt, SampleType type) noexcept {
+		raw = pcm;
+		format = fmt;
+		kind = Kind::eRaw;
+		channels = Metadata::channel_count(pcm.meta.format);
+		shared.meta = pcm.meta;
+		// 16-bit samples are always uploadable: stream as-is; float samples are converted on read if not of requested type
+		if (Metadata::sample_type(pcm.meta.format) == SampleType::eF32) { shared.meta.format = Metadata::make_format(channels, type); }
+		shared.remain = raw_count();
+		shared.bytes = shared.remain * Metadata::sample_size(shared.meta.format);
+		return Result<void>::success();
+	}
+
+	Result<void> open_reader(Reader& source, SampleType type) noexcept {
+		auto header = detail::CapoHeader{};
+		auto const meta = source.read(header) == header.size() ? detail::parse_capo_header(header) : std::nullopt;
+		if (!meta) { return Error::eInvalidData; }
+		// header records the frame count: reads past the actual end of data just return fewer samples
+		reader = &source;
+		raw.meta = *meta;
+		format = FileFormat::eCapo;
+		kind = Kind::eReader;
+		channels = Metadata::channel_count(meta->format);
+		shared.meta = *meta;
+		if (Metadata::sample_type(meta->format) == SampleType::eF32) { shared.meta.format = Metadata::make_format(channels, type); }
+		shared.remain = Metadata::sample_count(meta->total_frame_count, channels);
+		shared.bytes = shared.remain * Metadata::sample_size(shared.meta.format);
+		return Result<void>::success();
+	}
+
+	std::size_t raw_count() const noexcept { return raw.data.size() / Metadata::sample_size(raw.meta.format); }
+
+	template <typename T>
+	std::size_t read_reader(std::span<T> out_samples) noexcept {
+		auto const count = std::min(out_samples.size() / channels * channels, shared.remain);
+		auto const ret = read_samples(*reader, raw.meta.format, out_samples.first(count));
+		// truncated data: nothing more to read
+		shared.remain = ret < count ? 0 : shared.remain - ret;
+		return ret;
+	}
+
+	template <typename T>
+	std::size_t read_raw(std::span<T> out_samples) noexcept {
+		std::size_t const start = raw_count() - shared.remain;
+		std::size_t const ret = std::min(out_samples.size() / channels * channels, shared.remain);
+		if (Metadata::sample_type(raw.meta.format) == SampleType::eF32) {
+			detail::convert_samples(raw.samples<PCM::SampleF32>().subspan(start, ret), out_samples);
+		} else {
+			detail::convert_samples(raw.samples<PCM::Sample>().subspan(start, ret), out_samples);
+		}
+		shared.remain -= ret;
+		return ret;
+	}
+
+	template <typename T>
+	std::size_t read(std::span<T> out_samples) noexcept {
 		if (shared.remain == 0) { return 0; }
+		if (kind == Kind::eRaw) { return read_raw(out_samples); }
+		if (kind == Kind::eReader) { return read_reader(out_samples); }
+		if (kind != Kind::eDecoder) { return 0; }
 		auto readFrom = [&](auto& out) {
 			std::size_t combinedSize = out_samples.size() / channels;
+			if (!out->m_estimated) { combinedSize = std::min(combinedSize, shared.remain / channels); }
 			auto const read = out->read(out_samples, combinedSize);
 			auto const ret = read * channels;
-			assert(shared.remain >= ret);
-			shared.remain -= ret;
+			// estimated length: keep reading until the decoder runs dry
+			if (read == 0) {
+				shared.remain = 0;
+			} else {
+				shared.remain = shared.remain > ret ? shared.remain - ret : (out->m_estimated ? channels : 0);
+			}
 			return ret;
 		};
 		switch (format) {
@@ -239,9 +746,22 @@ struct PCM::Streamer::File {
 	}
 
 	bool seek(std::size_t frameIndex) noexcept {
+		if (kind == Kind::eRaw) {
+			shared.remain = raw_count() - std::min(frameIndex * channels, raw_count());
+			return true;
+		}
+		if (kind == Kind::eReader) {
+			auto const total = Metadata::sample_count(raw.meta.total_frame_count, channels);
+			auto const start = std::min(frameIndex * channels, total);
+			if (!reader->seek(detail::capo_header_size_v + start * Metadata::sample_size(raw.meta.format))) { return false; }
+			shared.remain = total - start;
+			return true;
+		}
+		if (kind != Kind::eDecoder) { return false; }
 		auto seekFrom = [&](auto& out) {
 			if (out->seek(frameIndex)) {
-				shared.remain = (out->m_meta.total_frame_count - frameIndex) * channels;
+				auto const total = out->m_meta.total_frame_count;
+				shared.remain = frameIndex < total ? (total - frameIndex) * channels : (out->m_estimated ? channels : 0);
 				return true;
 			}
 			return false;
@@ -260,57 +780,147 @@ struct PCM::Streamer::File {
 PCM::Streamer::Streamer() : m_impl(ktl::make_unique<File>()) {}
 PCM::Streamer::Streamer(Streamer&&) noexcept = default;
 PCM::Streamer& PCM::Streamer::operator=(Streamer&&) noexcept = default;
-PCM::Streamer::Streamer(char const* path) : Streamer() { open(path); }
+PCM::Streamer::Streamer(char const* path, SampleType type) : Streamer() { open(path, type); }
 PCM::Streamer::Streamer(PCM pcm) : Streamer() { preload(std::move(pcm)); }
 PCM::Streamer::~Streamer() noexcept = default;
 
-Result<void> PCM::Streamer::open(char const* path) {
-	m_preloaded.clear();
-	return m_impl->open(path);
+Result<void> PCM::Streamer::open(char const* path, SampleType type) {
+	m_preloaded.reset();
+	auto ret = m_impl->open(path, type);
+	m_impl->resample(m_impl->target_rate);
+	return ret;
 }
 
-void PCM::Streamer::preload(PCM pcm) noexcept {
-	m_preloaded = std::move(pcm.samples);
-	m_impl->shared = {pcm.meta, m_preloaded.size() * sizeof(PCM::Sample), m_preloaded.size()};
+Result<void> PCM::Streamer::open(std::span<std::byte const> bytes, FileFormat format, SampleType type) {
+	m_preloaded.reset();
+	if (bytes.empty()) { return Error::eIOError; }
+	auto ret = m_impl->open(bytes, format, type);
+	m_impl->resample(m_impl->target_rate);
+	return ret;
 }
 
-bool PCM::Streamer::valid() const noexcept { return !m_preloaded.empty() || m_impl->format != FileFormat::eUnknown; }
-Metadata const& PCM::Streamer::meta() const noexcept { return m_impl->shared.meta; }
-utils::Size PCM::Streamer::size() const noexcept { return utils::Size::make(m_impl->shared.bytes); }
-utils::Rate PCM::Streamer::rate() const noexcept { return m_impl->shared.meta.sample_rate(); }
-std::size_t PCM::Streamer::remain() const noexcept { return m_impl->shared.remain; }
+Result<void> PCM::Streamer::open(Reader& reader, FileFormat format, SampleType type) {
+	m_preloaded.reset();
+	auto ret = m_impl->open(reader, format, type);
+	m_impl->resample(m_impl->target_rate);
+	return ret;
+}
 
-std::size_t PCM::Streamer::read(std::span<PCM::Sample> out_samples) {
-	if (!m_preloaded.empty()) {
-		assert(m_impl->shared.remain <= m_preloaded.size());
-		std::size_t const start = m_preloaded.size() - m_impl->shared.remain;
-		if (start < m_preloaded.size()) {
-			std::size_t const end = start + out_samples.size();
-			std::size_t const ret = std::min(end - start, m_impl->shared.remain);
-			std::span<Sample> frame(m_preloaded.data() + start, ret);
-			std::copy(frame.begin(), frame.end(), out_samples.begin());
-			m_impl->shared.remain -= ret;
-			return ret;
+// move-constructed (not assigned): retains pcm's memory resource
+void PCM::Streamer::preload(PCM pcm) { preload(std::make_shared<PCM const>(std::move(pcm))); }
+
+void PCM::Streamer::preload(std::shared_ptr<PCM const> pcm) noexcept {
+	m_impl->reset();
+	auto const bytes = pcm ? pcm->data().size() : 0;
+	m_impl->shared = {pcm ? pcm->meta : Metadata{}, bytes, pcm ? bytes / Metadata::sample_size(pcm->meta.format) : 0};
+	m_preloaded = std::move(pcm);
+	m_impl->resample(m_impl->target_rate);
+}
+
+void PCM::Streamer::resample(SampleRate rate) { m_impl->resample(rate); }
+
+bool PCM::Streamer::valid() const noexcept { return preloaded() || m_impl->format != FileFormat::eUnknown; }
+Metadata const& PCM::Streamer::meta() const noexcept { return m_impl->resampler.active() ? m_impl->resampled : m_impl->shared.meta; }
+utils::Rate PCM::Streamer::rate() const noexcept { return meta().sample_rate(); }
+
+utils::Size PCM::Streamer::size() const noexcept {
+	if (m_impl->resampler.active()) { return utils::Size::make(sample_count() * Metadata::sample_size(meta().format)); }
+	return utils::Size::make(m_impl->shared.bytes);
+}
+
+std::size_t PCM::Streamer::remain() const noexcept {
+	auto const& resampler = m_impl->resampler;
+	if (resampler.active()) { return resampler.pending_frames(m_impl->shared.remain / resampler.channels()) * resampler.channels(); }
+	return m_impl->shared.remain;
+}
+
+template <typename T>
+std::size_t PCM::Streamer::read_preloaded(std::span<T> out_samples) {
+	std::size_t const total = preloaded_count();
+	assert(m_impl->shared.remain <= total);
+	std::size_t const start = total - m_impl->shared.remain;
+	if (start < total) {
+		std::size_t const ret = std::min(out_samples.size(), m_impl->shared.remain);
+		if (Metadata::sample_type(m_preloaded->meta.format) == SampleType::eF32) {
+			detail::convert_samples(std::span<SampleF32 const>(m_preloaded->samples_f32).subspan(start, ret), out_samples);
+		} else {
+			detail::convert_samples(std::span<Sample const>(m_preloaded->samples).subspan(start, ret), out_samples);
 		}
-		return 0;
-	} else {
-		return m_impl->read(out_samples);
+		m_impl->shared.remain -= ret;
+		return ret;
 	}
+	return 0;
+}
+
+template <typename T>
+std::size_t PCM::Streamer::read_source(std::span<T> out_samples) {
+	return preloaded() ? read_preloaded(out_samples) : m_impl->read(out_samples);
 }
 
+template <typename T>
+std::size_t PCM::Streamer::read_resampled(std::span<T> out_samples) {
+	constexpr std::size_t chunk_v = 1024; // source frames per read
+	auto& resampler = m_impl->resampler;
+	auto const channels = resampler.channels();
+	auto const count = out_samples.size() / channels * channels;
+	std::size_t ret{};
+	auto pull = [&] {
+		if constexpr (std::is_same_v<T, SampleF32>) {
+			ret += resampler.pull(out_samples.subspan(ret, count - ret));
+		} else {
+			auto& buffer = m_impl->resample_out;
+			buffer.resize(count - ret);
+			auto const pulled = resampler.pull(buffer);
+			detail::convert_samples(std::span<float const>(buffer).first(pulled), out_samples.subspan(ret));
+			ret += pulled;
+		}
+	};
+	pull();
+	while (ret < count && !resampler.drained()) {
+		auto& buffer = m_impl->resample_in;
+		buffer.resize(chunk_v * channels);
+		if (auto const read = read_source(std::span<float>(buffer)); read > 0) {
+			resampler.push(std::span<float const>(buffer).first(read));
+		} else {
+			resampler.flush();
+		}
+		pull();
+	}
+	return ret;
+}
+
+std::size_t PCM::Streamer::read(std::span<Sample> out_samples) { return m_impl->resampler.active() ? read_resampled(out_samples) : read_source(out_samples); }
+std::size_t PCM::Streamer::read(std::span<SampleF32> out_samples) { return m_impl->resampler.active() ? read_resampled(out_samples) : read_source(out_samples); }
+
 Result<void> PCM::Streamer::seek(Time stamp) noexcept {
 	float const ratio = valid() ? stamp / m_impl->shared.meta.length() : 0.0f;
-	if (!m_preloaded.empty()) {
-		m_impl->shared.remain = m_preloaded.size() - std::min(std::size_t(ratio * m_preloaded.size()), m_preloaded.size());
+	if (m_impl->resampler.active()) { m_impl->resampler.reset(); }
+	if (preloaded()) {
+		std::size_t const total = preloaded_count();
+		m_impl->shared.remain = total - std::min(std::size_t(ratio * total), total);
 		return Result<void>::success();
 	} else if (m_impl->format != FileFormat::eUnknown) {
-		std::size_t const total = sample_count() / m_impl->channels;
+		// source frames: meta() / sample_count() report the resampled length while resampling
+		std::size_t const total = m_impl->shared.meta.total_frame_count;
 		if (m_impl->seek(std::min(std::size_t(ratio * total), total))) { return Result<void>::success(); }
 		return Error::eUnknown;
 	}
 	return Error::eInvalidData;
 }
 
+bool PCM::Streamer::viewable() const noexcept { return preloaded() && !m_impl->resampler.active(); }
+
+std::span<std::byte const> PCM::Streamer::read_view(std::size_t const max_samples) noexcept {
+	if (!viewable()) { return {}; }
+	std::size_t const total = preloaded_count();
+	assert(m_impl->shared.remain <= total);
+	std::size_t const start = total - m_impl->shared.remain;
+	std::size_t const count = std::min(max_samples, m_impl->shared.remain);
+	m_impl->shared.remain -= count;
+	auto const sample_size = Metadata::sample_size(m_preloaded->meta.format);
+	return m_preloaded->data().subspan(start * sample_size, count * sample_size);
+}
+
 std::size_t PCM::Streamer::sample_count() const noexcept { return Metadata::sample_count(meta().total_frame_count, Metadata::channel_count(meta().format)); }
 Time PCM::Streamer::position() const noexcept { return detail::stream_progress(sample_count(), remain()) * meta().length(); }
 } // namespace capo
@@ -0,0 +1,157 @@
+#include <capo/pcm_cache.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace capo {
+namespace {
+// identifies a version of a file on disk
+struct Stamp {
+	std::uintmax_t size{};
+	std::filesystem::file_time_type modified{};
+
+	bool operator==(Stamp const&) const = default;
+};
+
+Stamp make_stamp(char const* path) noexcept {
+	auto ec = std::error_code{};
+	auto ret = Stamp{.size = std::filesystem::file_size(path, ec)};
+	ret.modified = std::filesystem::last_write_time(path, ec);
+	return ret;
+}
+} // namespace
+
+struct PCMCache::Impl {
+	using Future = std::shared_future<Result<Handle>>;
+	using Lru = std::list<std::string>;
+
+	struct Entry {
+		Future pcm{};
+		Stamp stamp{};
+		Lru::iterator lru{};
+		std::uint64_t id{};
+		std::size_t bytes{}; // 0 while decoding
+	};
+	using Map = std::unordered_map<std::string, Entry>;
+
+	Map entries{};
+	Lru lru{}; // front: most recently used
+	Stats stats{};
+	std::size_t budget{};
+	std::uint64_t next_id{};
+	mutable std::mutex mutex{};
+
+	void touch(Entry& entry) { lru.splice(lru.begin(), lru, entry.lru); }
+
+	void erase(Map::iterator it) {
+		stats.bytes -= it->second.bytes;
+		lru.erase(it->second.lru);
+		entries.erase(it);
+	}
+
+	// evict least recently used entries until within budget (skipping those still being decoded)
+	void trim() {
+		auto it = lru.end();
+		while (stats.bytes > budget && it != lru.begin()) {
+			auto const prev = std::prev(it);
+			if (auto entry = entries.find(*prev); entry->second.bytes > 0) {
+				erase(entry);
+				++stats.evictions;
+			} else {
+				it = prev;
+			}
+		}
+	}
+};
+
+// all SMFs need to be defined out-of-line for unique_ptr<incomplete_type> to compile
+PCMCache::PCMCache(std::size_t budget) : m_impl(ktl::make_unique<Impl>()) { m_impl->budget = budget; }
+PCMCache::PCMCache(PCMCache&&) noexcept = default;
+PCMCache& PCMCache::operator=(PCMCache&&) noexcept = default;
+PCMCache::~PCMCache() = default;
+
+Result<PCMCache::Handle> PCMCache::load(char const* path, FileFormat format, DecodeInfo const& info) {
+	auto const stamp = make_stamp(path);
+	auto key = std::string(path);
+	auto promise = std::promise<Result<Handle>>();
+	std::uint64_t id{};
+	{
+		auto lock = std::unique_lock(m_impl->mutex);
+		if (auto it = m_impl->entries.find(key); it != m_impl->entries.end()) {
+			if (it->second.stamp == stamp) {
+				++m_impl->stats.hits;
+				m_impl->touch(it->second);
+				auto pcm = it->second.pcm;
+				lock.unlock();
+				// may block until another thread finishes decoding this path
+				return pcm.get();
+			}
+			// file has changed since it was cached
+			m_impl->erase(it);
+		}
+		++m_impl->stats.misses;
+		id = m_impl->next_id++;
+		m_impl->lru.push_front(key);
+		m_impl->entries.emplace(key, Impl::Entry{promise.get_future().share(), stamp, m_impl->lru.begin(), id});
+	}
+	// decode outside the lock
+	auto pcm = PCM::from_file(path, format, info);
+	auto ret = pcm ? Result<Handle>(std::make_shared<PCM const>(std::move(*pcm))) : Result<Handle>(pcm.error());
+	{
+		auto lock = std::unique_lock(m_impl->mutex);
+		// entry may have been evicted / replaced in the meantime
+		if (auto it = m_impl->entries.find(key); it != m_impl->entries.end() && it->second.id == id) {
+			if (ret) {
+				it->second.bytes = std::max((*ret)->data().size(), std::size_t(1));
+				m_impl->stats.bytes += it->second.bytes;
+				m_impl->trim();
+			} else {
+				// don't cache failures
+				m_impl->erase(it);
+			}
+		}
+	}
+	promise.set_value(ret);
+	return ret;
+}
+
+bool PCMCache::evict(char const* path) {
+	auto lock = std::unique_lock(m_impl->mutex);
+	if (auto it = m_impl->entries.find(path); it != m_impl->entries.end()) {
+		m_impl->erase(it);
+		++m_impl->stats.evictions;
+		return true;
+	}
+	return false;
+}
+
+void PCMCache::clear() {
+	auto lock = std::unique_lock(m_impl->mutex);
+	m_impl->entries.clear();
+	m_impl->lru.clear();
+	m_impl->stats.bytes = 0;
+}
+
+void PCMCache::budget(std::size_t value) {
+	auto lock = std::unique_lock(m_impl->mutex);
+	m_impl->budget = value;
+	m_impl->trim();
+}
+
+std::size_t PCMCache::budget() const {
+	auto lock = std::unique_lock(m_impl->mutex);
+	return m_impl->budget;
+}
+
+PCMCache::Stats PCMCache::stats() const {
+	auto lock = std::unique_lock(m_impl->mutex);
+	auto ret = m_impl->stats;
+	ret.entries = m_impl->entries.size();
+	return ret;
+}
+} // namespace capo
@@ -0,0 +1,105 @@
+#include <impl_scheduler.hpp>
+#include <algorithm>
+#include <thread>
+
+namespace capo::detail {
+namespace {
+// decoding is light compared to mixing: a couple of threads service any number of streams
+constexpr std::size_t max_threads_v = 2;
+} // namespace
+
+StreamScheduler& StreamScheduler::instance() {
+	static StreamScheduler ret;
+	return ret;
+}
+
+StreamScheduler::StreamScheduler() {
+	auto const count = std::clamp(std::size_t(std::thread::hardware_concurrency()), std::size_t(1), max_threads_v);
+	m_threads.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		m_threads.emplace_back([this](ktl::kthread::stop_t stop) { run(stop); });
+		m_threads.back().m_join = ktl::kthread::policy::stop;
+	}
+}
+
+StreamScheduler::~StreamScheduler() {
+	{
+		std::scoped_lock lock(m_mutex);
+		m_stop = true;
+	}
+	m_work.notify_all();
+}
+
+void StreamScheduler::add(StreamTask& task) {
+	std::scoped_lock lock(m_mutex);
+	m_tasks.emplace(&task, State{});
+}
+
+void StreamScheduler::remove(StreamTask& task) {
+	std::unique_lock lock(m_mutex);
+	auto const it = m_tasks.find(&task);
+	if (it == m_tasks.end()) { return; }
+	m_done.wait(lock, [&] { return !it->second.running; });
+	if (it->second.deadline) { m_queue.erase({*it->second.deadline, &task}); }
+	m_tasks.erase(it);
+}
+
+void StreamScheduler::wake(StreamTask& task) {
+	{
+		std::scoped_lock lock(m_mutex);
+		auto const it = m_tasks.find(&task);
+		if (it == m_tasks.end()) { return; }
+		if (it->second.running) {
+			it->second.rewake = true;
+			return;
+		}
+		schedule(task, it->second, Clock::now());
+	}
+	m_work.notify_one();
+}
+
+std::size_t StreamScheduler::stream_count() const {
+	std::scoped_lock lock(m_mutex);
+	return m_tasks.size();
+}
+
+void StreamScheduler::schedule(StreamTask& task, State& state, Clock::time_point deadline) {
+	if (state.deadline) {
+		if (*state.deadline <= deadline) { return; } // already due sooner
+		m_queue.erase({*state.deadline, &task});
+	}
+	state.deadline = deadline;
+	m_queue.emplace(deadline, &task);
+}
+
+void StreamScheduler::run(ktl::kthread::stop_t const& stop) {
+	std::unique_lock lock(m_mutex);
+	while (!m_stop && !stop.stop_requested()) {
+		if (m_queue.empty()) {
+			m_work.wait(lock);
+			continue;
+		}
+		auto const [deadline, task] = *m_queue.begin();
+		if (deadline > Clock::now()) {
+			m_work.wait_until(lock, deadline);
+			continue;
+		}
+		m_queue.erase(m_queue.begin());
+		auto& state = m_tasks.at(task);
+		state.deadline.reset();
+		state.running = true;
+		lock.unlock();
+		auto const next = task->service();
+		lock.lock();
+		state.running = false;
+		if (std::exchange(state.rewake, false)) {
+			schedule(*task, state, Clock::now());
+		} else if (next) {
+			schedule(*task, state, *next);
+		}
+		m_done.notify_all();
+		// another thread may be waiting on a (now) earlier deadline
+		m_work.notify_one();
+	}
+}
+} // namespace capo::detail
@@ -0,0 +1,365 @@
+#include <impl_simd.hpp>
+#include <algorithm>
+
+#if defined(CAPO_SIMD_X86)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+#if defined(CAPO_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+// AVX2 kernels are compiled for their target alone (dispatched at runtime), the rest of the library remains baseline
+#if defined(CAPO_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CAPO_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define CAPO_TARGET_AVX2
+#endif
+
+namespace capo::detail {
+namespace {
+constexpr float s16_scale_v = 1.0f / 32768.0f;
+constexpr float s16_max_v = 32767.0f;
+constexpr float s16_min_v = -32768.0f;
+
+// scalar kernels: also handle the tails of vectorized ones
+
+float dot_scalar(float const* a, float const* b, std::size_t count) noexcept {
+	// independent accumulators: lets the compiler pipeline (and auto-vectorize) the loop
+	float acc[4]{};
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		for (std::size_t j = 0; j < 4; ++j) { acc[j] += a[i + j] * b[i + j]; }
+	}
+	for (; i < count; ++i) { acc[0] += a[i] * b[i]; }
+	return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+void s16_to_f32_scalar(std::int16_t const* in, float* out, std::size_t count) noexcept {
+	for (std::size_t i = 0; i < count; ++i) { out[i] = static_cast<float>(in[i]) * s16_scale_v; }
+}
+
+void f32_to_s16_scalar(float const* in, std::int16_t* out, std::size_t count) noexcept {
+	for (std::size_t i = 0; i < count; ++i) { out[i] = static_cast<std::int16_t>(std::clamp(in[i] * 32768.0f, s16_min_v, s16_max_v)); }
+}
+
+void mono_to_stereo_scalar(float const* in, float* out, std::size_t frames) noexcept {
+	for (std::size_t i = 0; i < frames; ++i) { out[2 * i] = out[2 * i + 1] = in[i]; }
+}
+
+void stereo_to_mono_scalar(float const* in, float* out, std::size_t frames) noexcept {
+	for (std::size_t i = 0; i < frames; ++i) { out[i] = 0.5f * (in[2 * i] + in[2 * i + 1]); }
+}
+
+void gain_scalar(float* data, std::size_t count, float gain) noexcept {
+	for (std::size_t i = 0; i < count; ++i) { data[i] *= gain; }
+}
+
+void interleave_scalar(float const* left, float const* right, float* out, std::size_t frames) noexcept {
+	for (std::size_t i = 0; i < frames; ++i) {
+		out[2 * i] = left[i];
+		out[2 * i + 1] = right[i];
+	}
+}
+
+void deinterleave_scalar(float const* in, float* left, float* right, std::size_t frames) noexcept {
+	for (std::size_t i = 0; i < frames; ++i) {
+		left[i] = in[2 * i];
+		right[i] = in[2 * i + 1];
+	}
+}
+
+#if defined(CAPO_SIMD_X86)
+float dot_sse2(float const* a, float const* b, std::size_t count) noexcept {
+	__m128 acc = _mm_setzero_ps();
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4) { acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i))); }
+	alignas(16) float lanes[4];
+	_mm_store_ps(lanes, acc);
+	float ret = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	for (; i < count; ++i) { ret += a[i] * b[i]; }
+	return ret;
+}
+
+void s16_to_f32_sse2(std::int16_t const* in, float* out, std::size_t count) noexcept {
+	__m128 const scale = _mm_set1_ps(s16_scale_v);
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+		// sign-extend 16 => 32 bits: place each sample in the high half, then shift arithmetic
+		__m128i const lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		__m128i const hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+	s16_to_f32_scalar(in + i, out + i, count - i);
+}
+
+void f32_to_s16_sse2(float const* in, std::int16_t* out, std::size_t count) noexcept {
+	__m128 const scale = _mm_set1_ps(32768.0f);
+	__m128 const max = _mm_set1_ps(s16_max_v);
+	__m128 const min = _mm_set1_ps(s16_min_v);
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128 const a = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), max), min);
+		__m128 const b = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), max), min);
+		// truncate (as static_cast), then narrow with saturation
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b)));
+	}
+	f32_to_s16_scalar(in + i, out + i, count - i);
+}
+
+void mono_to_stereo_sse2(float const* in, float* out, std::size_t frames) noexcept {
+	std::size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		__m128 const x = _mm_loadu_ps(in + i);
+		_mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(x, x));
+		_mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(x, x));
+	}
+	mono_to_stereo_scalar(in + i, out + 2 * i, frames - i);
+}
+
+void stereo_to_mono_sse2(float const* in, float* out, std::size_t frames) noexcept {
+	__m128 const half = _mm_set1_ps(0.5f);
+	std::size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		__m128 const a = _mm_loadu_ps(in + 2 * i);
+		__m128 const b = _mm_loadu_ps(in + 2 * i + 4);
+		__m128 const left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 const right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(left, right), half));
+	}
+	stereo_to_mono_scalar(in + 2 * i, out + i, frames - i);
+}
+
+void gain_sse2(float* data, std::size_t count, float gain) noexcept {
+	__m128 const g = _mm_set1_ps(gain);
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4) { _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), g)); }
+	gain_scalar(data + i, count - i, gain);
+}
+
+void interleave_sse2(float const* left, float const* right, float* out, std::size_t frames) noexcept {
+	std::size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		__m128 const l = _mm_loadu_ps(left + i);
+		__m128 const r = _mm_loadu_ps(right + i);
+		_mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));
+		_mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));
+	}
+	interleave_scalar(left + i, right + i, out + 2 * i, frames - i);
+}
+
+void deinterleave_sse2(float const* in, float* left, float* right, std::size_t frames) noexcept {
+	std::size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		__m128 const a = _mm_loadu_ps(in + 2 * i);
+		__m128 const b = _mm_loadu_ps(in + 2 * i + 4);
+		_mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+	deinterleave_scalar(in + 2 * i, left + i, right + i, frames - i);
+}
+
+CAPO_TARGET_AVX2 float dot_avx2(float const* a, float const* b, std::size_t count) noexcept {
+	__m256 acc0 = _mm256_setzero_ps();
+	__m256 acc1 = _mm256_setzero_ps();
+	std::size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+		acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+	}
+	for (; i + 8 <= count; i += 8) { acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0); }
+	__m256 const acc = _mm256_add_ps(acc0, acc1);
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x1));
+	float ret = _mm_cvtss_f32(sum);
+	for (; i < count; ++i) { ret += a[i] * b[i]; }
+	return ret;
+}
+
+CAPO_TARGET_AVX2 void s16_to_f32_avx2(std::int16_t const* in, float* out, std::size_t count) noexcept {
+	__m256 const scale = _mm256_set1_ps(s16_scale_v);
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i const x = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i)));
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+	}
+	s16_to_f32_scalar(in + i, out + i, count - i);
+}
+
+CAPO_TARGET_AVX2 void f32_to_s16_avx2(float const* in, std::int16_t* out, std::size_t count) noexcept {
+	__m256 const scale = _mm256_set1_ps(32768.0f);
+	__m256 const max = _mm256_set1_ps(s16_max_v);
+	__m256 const min = _mm256_set1_ps(s16_min_v);
+	std::size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256 const a = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale), max), min);
+		__m256 const b = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), scale), max), min);
+		// packs operates per 128-bit lane: restore order of the 64-bit quarters afterwards
+		__m256i const packed = _mm256_packs_epi32(_mm256_cvttps_epi32(a), _mm256_cvttps_epi32(b));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+	f32_to_s16_sse2(in + i, out + i, count - i);
+}
+
+CAPO_TARGET_AVX2 void gain_avx2(float* data, std::size_t count, float gain) noexcept {
+	__m256 const g = _mm256_set1_ps(gain);
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) { _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), g)); }
+	gain_scalar(data + i, count - i, gain);
+}
+
+bool avx2_supported() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4]{};
+	__cpuid(info, 0);
+	if (info[0] < 7) { return false; }
+	__cpuid(info, 1);
+	bool const osxsave = (info[2] & (1 << 27)) != 0;
+	bool const fma = (info[2] & (1 << 12)) != 0;
+	// OS must save / restore YMM registers
+	if (!osxsave || !fma || (_xgetbv(0) & 0x6) != 0x6) { return false; }
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
+
+#if defined(CAPO_SIMD_NEON)
+float dot_neon(float const* a, float const* b, std::size_t count) noexcept {
+	float32x4_t acc0 = vdupq_n_f32(0.0f);
+	float32x4_t acc1 = vdupq_n_f32(0.0f);
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+		acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+	}
+	for (; i + 4 <= count; i += 4) { acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i)); }
+	float32x4_t const acc = vaddq_f32(acc0, acc1);
+	float32x2_t const half = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+	float ret = vget_lane_f32(vpadd_f32(half, half), 0);
+	for (; i < count; ++i) { ret += a[i] * b[i]; }
+	return ret;
+}
+
+void s16_to_f32_neon(std::int16_t const* in, float* out, std::size_t count) noexcept {
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		int16x8_t const x = vld1q_s16(in + i);
+		vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), s16_scale_v));
+		vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), s16_scale_v));
+	}
+	s16_to_f32_scalar(in + i, out + i, count - i);
+}
+
+void f32_to_s16_neon(float const* in, std::int16_t* out, std::size_t count) noexcept {
+	float32x4_t const max = vdupq_n_f32(s16_max_v);
+	float32x4_t const min = vdupq_n_f32(s16_min_v);
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		float32x4_t const a = vmaxq_f32(vminq_f32(vmulq_n_f32(vld1q_f32(in + i), 32768.0f), max), min);
+		float32x4_t const b = vmaxq_f32(vminq_f32(vmulq_n_f32(vld1q_f32(in + i + 4), 32768.0f), max), min);
+		vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vcvtq_s32_f32(a)), vqmovn_s32(vcvtq_s32_f32(b))));
+	}
+	f32_to_s16_scalar(in + i, out + i, count - i);
+}
+
+void mono_to_stereo_neon(float const* in, float* out, std::size_t frames) noexcept {
+	std::size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		float32x4_t const x = vld1q_f32(in + i);
+		vst2q_f32(out + 2 * i, float32x4x2_t{{x, x}});
+	}
+	mono_to_stereo_scalar(in + i, out + 2 * i, frames - i);
+}
+
+void stereo_to_mono_neon(float const* in, float* out, std::size_t frames) noexcept {
+	std::size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		float32x4x2_t const x = vld2q_f32(in + 2 * i);
+		vst1q_f32(out + i, vmulq_n_f32(vaddq_f32(x.val[0], x.val[1]), 0.5f));
+	}
+	stereo_to_mono_scalar(in + 2 * i, out + i, frames - i);
+}
+
+void gain_neon(float* data, std::size_t count, float gain) noexcept {
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4) { vst1q_f32(data + i, vmulq_n_f32(vld1q_f32(data + i), gain)); }
+	gain_scalar(data + i, count - i, gain);
+}
+
+void interleave_neon(float const* left, float const* right, float* out, std::size_t frames) noexcept {
+	std::size_t i = 0;
+	for (; i + 4 <= frames; i += 4) { vst2q_f32(out + 2 * i, float32x4x2_t{{vld1q_f32(left + i), vld1q_f32(right + i)}}); }
+	interleave_scalar(left + i, right + i, out + 2 * i, frames - i);
+}
+
+void deinterleave_neon(float const* in, float* left, float* right, std::size_t frames) noexcept {
+	std::size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		float32x4x2_t const x = vld2q_f32(in + 2 * i);
+		vst1q_f32(left + i, x.val[0]);
+		vst1q_f32(right + i, x.val[1]);
+	}
+	deinterleave_scalar(in + 2 * i, left + i, right + i, frames - i);
+}
+#endif
+
+SimdLevel detect() noexcept {
+#if defined(CAPO_SIMD_X86)
+	return avx2_supported() ? SimdLevel::eAvx2 : SimdLevel::eSse2;
+#elif defined(CAPO_SIMD_NEON)
+	return SimdLevel::eNeon;
+#else
+	return SimdLevel::eScalar;
+#endif
+}
+
+constexpr Kernels scalar_v{
+	&dot_scalar, &s16_to_f32_scalar, &f32_to_s16_scalar, &mono_to_stereo_scalar, &stereo_to_mono_scalar, &gain_scalar, &interleave_scalar, &deinterleave_scalar,
+};
+#if defined(CAPO_SIMD_X86)
+constexpr Kernels sse2_v{
+	&dot_sse2, &s16_to_f32_sse2, &f32_to_s16_sse2, &mono_to_stereo_sse2, &stereo_to_mono_sse2, &gain_sse2, &interleave_sse2, &deinterleave_sse2,
+};
+// shuffles gain nothing from 256-bit registers (lane crossing): reuse SSE2
+constexpr Kernels avx2_v{
+	&dot_avx2, &s16_to_f32_avx2, &f32_to_s16_avx2, &mono_to_stereo_sse2, &stereo_to_mono_sse2, &gain_avx2, &interleave_sse2, &deinterleave_sse2,
+};
+#endif
+#if defined(CAPO_SIMD_NEON)
+constexpr Kernels neon_v{
+	&dot_neon, &s16_to_f32_neon, &f32_to_s16_neon, &mono_to_stereo_neon, &stereo_to_mono_neon, &gain_neon, &interleave_neon, &deinterleave_neon,
+};
+#endif
+} // namespace
+
+SimdLevel simd_level() noexcept {
+	static SimdLevel const ret = detect();
+	return ret;
+}
+
+Kernels const& kernels(SimdLevel level) noexcept {
+	switch (level) {
+#if defined(CAPO_SIMD_X86)
+	case SimdLevel::eSse2: return sse2_v;
+	case SimdLevel::eAvx2: return simd_level() == SimdLevel::eAvx2 ? avx2_v : sse2_v;
+#endif
+#if defined(CAPO_SIMD_NEON)
+	case SimdLevel::eNeon: return neon_v;
+#endif
+	default: return scalar_v;
+	}
+}
+
+Kernels const& kernels() noexcept {
+	static Kernels const& ret = kernels(simd_level());
+	return ret;
+}
+} // namespace capo::detail
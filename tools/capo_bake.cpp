@@ -0,0 +1,109 @@
+#include <capo/capo.hpp>
+#include <ktl/kformat.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace {
+namespace fs = std::filesystem;
+
+static constexpr int fail_code = 2;
+
+bool bakeable(fs::path const& path) {
+	auto ext = path.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return ext == ".wav" || ext == ".flac" || ext == ".mp3";
+}
+
+struct Job {
+	fs::path in;
+	fs::path out;
+};
+
+// mirror directory structure of in_dir under out_dir, replacing extensions with .capo
+std::vector<Job> collect(fs::path const& in_dir, fs::path const& out_dir) {
+	auto ret = std::vector<Job>{};
+	auto ec = std::error_code{};
+	// error_code overloads throughout: unreadable entries are skipped instead of throwing
+	auto it = fs::recursive_directory_iterator(in_dir, fs::directory_options::skip_permission_denied, ec);
+	for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+		auto const& entry = *it;
+		if (!entry.is_regular_file(ec) || !bakeable(entry.path())) { continue; }
+		auto out = out_dir / fs::relative(entry.path(), in_dir);
+		out.replace_extension(".capo");
+		ret.push_back({entry.path(), std::move(out)});
+	}
+	return ret;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cerr << "Syntax: " << argv[0] << " <input directory> <output directory> [threads] [--f32]" << std::endl;
+		return fail_code;
+	}
+	auto const in_dir = fs::path(argv[1]);
+	auto const out_dir = fs::path(argv[2]);
+	auto threads = std::size_t{};
+	auto type = capo::SampleType::eS16;
+	for (int i = 3; i < argc; ++i) {
+		if (std::string_view(argv[i]) == "--f32") {
+			type = capo::SampleType::eF32;
+		} else {
+			threads = static_cast<std::size_t>(std::max(std::atoi(argv[i]), 0));
+		}
+	}
+	auto ec = std::error_code{};
+	if (!fs::is_directory(in_dir, ec)) {
+		std::cerr << "Not a directory: " << in_dir.generic_string() << std::endl;
+		return fail_code;
+	}
+
+	auto const jobs = collect(in_dir, out_dir);
+	auto requests = std::vector<capo::Loader::Request>{};
+	requests.reserve(jobs.size());
+	for (auto const& job : jobs) {
+		// create output directories up front: workers only write files
+		fs::create_directories(job.out.parent_path(), ec);
+		requests.push_back({.source = job.in.string(), .decode = {.type = type}});
+	}
+
+	// each worker decodes and writes its own file: clips are baked in parallel, one per thread
+	auto loader = capo::Loader(threads);
+	auto failed = std::atomic<std::size_t>{};
+	auto mutex = std::mutex{};
+	auto on_loaded = [&](std::size_t index, capo::Result<capo::PCM> const& pcm) {
+		auto const& job = jobs[index];
+		auto const result = pcm ? pcm->bake(job.out.string().c_str()) : capo::Result<void>(pcm.error());
+		auto lock = std::scoped_lock(mutex);
+		if (!result) {
+			++failed;
+			std::cerr << ktl::kformat("  [FAIL] {} (Error: {})\n", job.in.generic_string(), static_cast<int>(result.error()));
+			return;
+		}
+		std::cout << ktl::kformat("  {} => {} [{:.1f}s, {}]\n", job.in.generic_string(), job.out.generic_string(), pcm->meta.length().count(), pcm->size());
+	};
+	std::cout << ktl::kformat("Baking {} file(s) on {} thread(s)\n", jobs.size(), loader.threads());
+	// bounded window of in-flight clips: each decoded PCM is released (with its future) once baked
+	auto const window = std::max(loader.threads(), std::size_t(1)) * 2;
+	auto in_flight = std::deque<std::future<capo::Result<capo::PCM>>>{};
+	for (std::size_t i = 0; i < requests.size(); ++i) {
+		if (in_flight.size() >= window) {
+			in_flight.front().get();
+			in_flight.pop_front();
+		}
+		auto batch = loader.load(std::span(requests).subspan(i, 1), [&on_loaded, i](std::size_t, capo::Result<capo::PCM> const& pcm) { on_loaded(i, pcm); });
+		in_flight.push_back(std::move(batch.futures.front()));
+	}
+	for (auto& future : in_flight) { future.get(); }
+	std::cout << ktl::kformat("{} baked, {} failed\n", jobs.size() - failed, failed.load());
+	return failed > 0 ? fail_code : 0;
+}